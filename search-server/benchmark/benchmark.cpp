@@ -0,0 +1,156 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <iomanip>
+#include <sys/resource.h>
+
+using namespace std;
+
+AllocationCounters& GetAllocationCounters() {
+    static AllocationCounters counters;
+    return counters;
+}
+
+BenchmarkState::BenchmarkState(uint64_t iterations)
+    : iterations_(iterations)
+    , remaining_(iterations)
+{
+}
+
+bool BenchmarkState::KeepRunning() {
+    if (!started_) {
+        started_ = true;
+        ResumeTiming();
+    }
+    if (remaining_ == 0) {
+        if (running_) {
+            PauseTiming();
+        }
+        return false;
+    }
+    --remaining_;
+    return true;
+}
+
+void BenchmarkState::PauseTiming() {
+    elapsed_ += Clock::now() - start_time_;
+    const AllocationCounters& counters = GetAllocationCounters();
+    allocations_ += counters.count.load(std::memory_order_relaxed) - start_allocations_;
+    allocated_bytes_ += counters.bytes.load(std::memory_order_relaxed) - start_allocated_bytes_;
+    running_ = false;
+}
+
+void BenchmarkState::ResumeTiming() {
+    const AllocationCounters& counters = GetAllocationCounters();
+    start_allocations_ = counters.count.load(std::memory_order_relaxed);
+    start_allocated_bytes_ = counters.bytes.load(std::memory_order_relaxed);
+    running_ = true;
+    start_time_ = Clock::now();
+}
+
+uint64_t BenchmarkState::GetIterations() const {
+    return iterations_;
+}
+
+void BenchmarkState::SetItemsProcessed(uint64_t items) {
+    items_processed_ = items;
+}
+
+void BenchmarkState::SetBytesProcessed(uint64_t bytes) {
+    bytes_processed_ = bytes;
+}
+
+void BenchmarkRunner::Register(std::string name, Function function) {
+    benchmarks_.push_back({ std::move(name), std::move(function) });
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::Run(const std::string& filter, std::chrono::duration<double> min_time) const {
+    std::vector<BenchmarkResult> results;
+    for (const Benchmark& benchmark : benchmarks_) {
+        if (benchmark.name.find(filter) != std::string::npos) {
+            results.push_back(RunOne(benchmark, min_time));
+        }
+    }
+    return results;
+}
+
+BenchmarkResult BenchmarkRunner::RunOne(const Benchmark& benchmark, std::chrono::duration<double> min_time) {
+    const uint64_t max_iterations = 1'000'000'000;
+    uint64_t iterations = 1;
+    while (true) {
+        BenchmarkState state(iterations);
+        benchmark.function(state);
+        const double seconds = std::chrono::duration<double>(state.elapsed_).count();
+        if (seconds >= min_time.count() || iterations >= max_iterations) {
+            BenchmarkResult result;
+            result.name = benchmark.name;
+            result.iterations = iterations;
+            result.nanoseconds_per_op = seconds * 1e9 / iterations;
+            result.items_per_second = seconds > 0 ? state.items_processed_ / seconds : 0.0;
+            result.bytes_per_second = seconds > 0 ? state.bytes_processed_ / seconds : 0.0;
+            result.allocations_per_op = static_cast<double>(state.allocations_) / iterations;
+            result.allocated_bytes_per_op = static_cast<double>(state.allocated_bytes_) / iterations;
+            result.peak_rss_kib = GetPeakRssKib();
+            return result;
+        }
+        // Следующий прогон рассчитан на min_time с запасом, но не больше чем в 10 раз длиннее текущего
+        const double scale = seconds > 0 ? min_time.count() * 1.4 / seconds : 10.0;
+        iterations = std::min(max_iterations, std::max(iterations + 1, static_cast<uint64_t>(iterations * std::min(scale, 10.0))));
+    }
+}
+
+uint64_t GetPeakRssKib() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // В Linux ru_maxrss уже в килобайтах
+    return static_cast<uint64_t>(usage.ru_maxrss);
+}
+
+namespace {
+
+std::string EscapeJson(const std::string& text) {
+    std::string escaped;
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+            escaped.push_back(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            const char* hex = "0123456789abcdef";
+            escaped += "\\u00"s;
+            escaped.push_back(hex[(c >> 4) & 0xF]);
+            escaped.push_back(hex[c & 0xF]);
+        }
+        else {
+            escaped.push_back(c);
+        }
+    }
+    return escaped;
+}
+
+} // namespace
+
+void PrintJson(std::ostream& output, const std::vector<std::pair<std::string, std::string>>& context,
+    const std::vector<BenchmarkResult>& results) {
+    output << std::setprecision(6) << std::fixed;
+    output << "{\n  \"context\": {"s;
+    bool first = true;
+    for (const auto& [key, value] : context) {
+        output << (first ? "\n"s : ",\n"s) << "    \""s << EscapeJson(key) << "\": \""s << EscapeJson(value) << "\""s;
+        first = false;
+    }
+    output << "\n  },\n  \"benchmarks\": ["s;
+    first = true;
+    for (const BenchmarkResult& result : results) {
+        output << (first ? "\n"s : ",\n"s)
+            << "    {\"name\": \""s << EscapeJson(result.name) << "\""s
+            << ", \"iterations\": "s << result.iterations
+            << ", \"ns_per_op\": "s << result.nanoseconds_per_op
+            << ", \"items_per_second\": "s << result.items_per_second
+            << ", \"bytes_per_second\": "s << result.bytes_per_second
+            << ", \"allocations_per_op\": "s << result.allocations_per_op
+            << ", \"allocated_bytes_per_op\": "s << result.allocated_bytes_per_op
+            << ", \"peak_rss_kib\": "s << result.peak_rss_kib << "}"s;
+        first = false;
+    }
+    output << "\n  ]\n}\n"s;
+}
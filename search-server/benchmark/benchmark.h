@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Счётчики выделений памяти. Увеличиваются заменой глобального operator new в программе замеров.
+struct AllocationCounters {
+    std::atomic<uint64_t> count = 0;
+    std::atomic<uint64_t> bytes = 0;
+};
+
+AllocationCounters& GetAllocationCounters();
+
+// Состояние одного прогона замера. Тело замера крутит цикл while (state.KeepRunning()),
+// подготовку внутри цикла заключает в PauseTiming/ResumeTiming.
+class BenchmarkState {
+public:
+    explicit BenchmarkState(uint64_t iterations);
+
+    bool KeepRunning();
+
+    void PauseTiming();
+
+    void ResumeTiming();
+
+    uint64_t GetIterations() const;
+
+    // Сколько элементов (запросов, документов) и байт обработано за весь прогон, для расчёта пропускной способности
+    void SetItemsProcessed(uint64_t items);
+
+    void SetBytesProcessed(uint64_t bytes);
+
+private:
+    friend class BenchmarkRunner;
+
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t iterations_;
+    uint64_t remaining_;
+    bool started_ = false;
+    bool running_ = false;
+    Clock::time_point start_time_;
+    Clock::duration elapsed_{};
+    uint64_t start_allocations_ = 0;
+    uint64_t start_allocated_bytes_ = 0;
+    uint64_t allocations_ = 0;
+    uint64_t allocated_bytes_ = 0;
+    uint64_t items_processed_ = 0;
+    uint64_t bytes_processed_ = 0;
+};
+
+// Не даёт компилятору выбросить вычисление, результат которого не используется
+template <typename Value>
+inline void DoNotOptimize(const Value& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchmarkResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double nanoseconds_per_op = 0.0;
+    double items_per_second = 0.0;
+    double bytes_per_second = 0.0;
+    double allocations_per_op = 0.0;
+    double allocated_bytes_per_op = 0.0;
+    // Пиковый объём памяти процесса после прогона
+    uint64_t peak_rss_kib = 0;
+};
+
+// Замеры регистрируются по имени и запускаются по очереди. Число итераций подбирается так,
+// чтобы прогон длился не меньше min_time: короткий прогон повторяется с большим числом итераций.
+class BenchmarkRunner {
+public:
+    using Function = std::function<void(BenchmarkState&)>;
+
+    void Register(std::string name, Function function);
+
+    // Запускает замеры, в имени которых есть filter
+    std::vector<BenchmarkResult> Run(const std::string& filter, std::chrono::duration<double> min_time) const;
+
+private:
+    struct Benchmark {
+        std::string name;
+        Function function;
+    };
+
+    std::vector<Benchmark> benchmarks_;
+
+    static BenchmarkResult RunOne(const Benchmark& benchmark, std::chrono::duration<double> min_time);
+};
+
+uint64_t GetPeakRssKib();
+
+// Результаты в JSON: контекст запуска (произвольные пары ключ-значение) и список замеров
+void PrintJson(std::ostream& output, const std::vector<std::pair<std::string, std::string>>& context,
+    const std::vector<BenchmarkResult>& results);
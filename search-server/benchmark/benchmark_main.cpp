@@ -0,0 +1,444 @@
+// Замеры производительности сервера на синтетическом корпусе.
+// Собирается отдельной программой из файлов этого каталога и всех файлов сервера, кроме main.cpp:
+//   g++ -std=c++17 -O2 -I.. *.cpp $(ls ../*.cpp | grep -v main.cpp) -ltbb -lpthread -o search_server_benchmark
+// Параметры: --filter=подстрока --min_time=секунды --documents=N --queries=N --seed=N --out=файл.json
+// Результаты печатаются в JSON: время на операцию, пропускная способность, выделения памяти и пиковый RSS.
+
+#include "benchmark.h"
+#include "corpus_generator.h"
+#include "../durable_search_server.h"
+#include "../remove_duplicates.h"
+#include "../search_server.h"
+#include "../string_processing.h"
+#include <cstdlib>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <streambuf>
+#include <thread>
+
+using namespace std;
+
+void* operator new(std::size_t size) {
+    AllocationCounters& counters = GetAllocationCounters();
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+
+// Для RemoveDuplicates сервер пересобирается перед каждой итерацией, поэтому корпус берётся меньше
+const size_t DUPLICATES_DOCUMENT_COUNT = 2000;
+
+std::unique_ptr<SearchServer> BuildServer(const Corpus& corpus, size_t document_count) {
+    auto search_server = std::make_unique<SearchServer>(corpus.stop_words);
+    for (size_t i = 0; i < document_count; ++i) {
+        search_server->AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, corpus.ratings[i]);
+    }
+    return search_server;
+}
+
+void RegisterBenchmarks(BenchmarkRunner& runner, const Corpus& corpus) {
+    const size_t document_count = corpus.documents.size();
+
+    runner.Register("Tokenize/SplitIntoWords"s, [&corpus, document_count](BenchmarkState& state) {
+        uint64_t bytes = 0;
+        size_t i = 0;
+        while (state.KeepRunning()) {
+            const std::string& text = corpus.documents[i++ % document_count];
+            DoNotOptimize(SplitIntoWords(std::string_view(text)));
+            bytes += text.size();
+        }
+        state.SetItemsProcessed(state.GetIterations());
+        state.SetBytesProcessed(bytes);
+    });
+
+    runner.Register("AddDocument"s, [&corpus, document_count](BenchmarkState& state) {
+        auto search_server = std::make_unique<SearchServer>(corpus.stop_words);
+        size_t i = 0;
+        while (state.KeepRunning()) {
+            if (i == document_count) {
+                state.PauseTiming();
+                search_server = std::make_unique<SearchServer>(corpus.stop_words);
+                i = 0;
+                state.ResumeTiming();
+            }
+            search_server->AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, corpus.ratings[i]);
+            ++i;
+        }
+        state.SetItemsProcessed(state.GetIterations());
+    });
+
+    // То же добавление через журнал: каталог журнала создаётся во временном каталоге системы
+    runner.Register("AddDocument/durable"s, [&corpus, document_count](BenchmarkState& state) {
+        const std::filesystem::path directory = std::filesystem::temp_directory_path() / "search_server_benchmark_wal"s;
+        const auto open = [&] {
+            std::filesystem::remove_all(directory);
+            DurabilityOptions options;
+            options.checkpoint_bytes = 0;
+            return std::make_unique<DurableSearchServer>(directory.string(), corpus.stop_words, options);
+        };
+        auto search_server = open();
+        size_t i = 0;
+        while (state.KeepRunning()) {
+            if (i == document_count) {
+                state.PauseTiming();
+                search_server.reset();
+                search_server = open();
+                i = 0;
+                state.ResumeTiming();
+            }
+            search_server->AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, corpus.ratings[i]);
+            ++i;
+        }
+        search_server->Sync();
+        state.SetItemsProcessed(state.GetIterations());
+        search_server.reset();
+        std::filesystem::remove_all(directory);
+    });
+
+    runner.Register("AddDocuments/bulk"s, [&corpus, document_count](BenchmarkState& state) {
+        std::vector<DocumentInput> documents;
+        for (size_t i = 0; i < document_count; ++i) {
+            documents.push_back({ static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, corpus.ratings[i] });
+        }
+        std::unique_ptr<SearchServer> search_server;
+        while (state.KeepRunning()) {
+            state.PauseTiming();
+            search_server = std::make_unique<SearchServer>(corpus.stop_words);
+            state.ResumeTiming();
+            DoNotOptimize(search_server->AddDocuments(documents));
+        }
+        state.SetItemsProcessed(state.GetIterations() * document_count);
+    });
+
+    const auto register_find = [&](const std::string& name, auto policy) {
+        runner.Register("FindTopDocuments/"s + name, [&corpus, document_count, policy](BenchmarkState& state) {
+            static std::unique_ptr<SearchServer> search_server;
+            if (!search_server) {
+                search_server = BuildServer(corpus, document_count);
+            }
+            size_t i = 0;
+            while (state.KeepRunning()) {
+                DoNotOptimize(search_server->FindTopDocuments(policy, corpus.queries[i++ % corpus.queries.size()]));
+            }
+            state.SetItemsProcessed(state.GetIterations());
+        });
+    };
+    register_find("seq"s, std::execution::seq);
+    register_find("par"s, std::execution::par);
+    register_find("wand"s, search_policy::wand);
+
+    // Запросы корпуса, у которых первые два плюс-слова взяты в кавычки, на сервере с индексом позиций и учётом близости
+    runner.Register("FindTopDocuments/phrase"s, [&corpus, document_count](BenchmarkState& state) {
+        static std::unique_ptr<SearchServer> search_server;
+        if (!search_server) {
+            search_server = BuildServer(corpus, document_count);
+            search_server->EnablePositionIndex({ 0.5 });
+        }
+        std::vector<std::string> queries;
+        for (const std::string& query : corpus.queries) {
+            std::string phrase_query;
+            size_t phrase_words = 0;
+            for (const std::string_view word : SplitIntoWords(query)) {
+                if (word[0] != '-' && phrase_words < 2) {
+                    phrase_query += phrase_words == 0 ? "\""s : " "s;
+                    phrase_query.append(word);
+                    if (++phrase_words == 2) {
+                        phrase_query += "\""s;
+                    }
+                }
+                else {
+                    phrase_query.append(" "s).append(word);
+                }
+            }
+            if (phrase_words == 2) {
+                queries.push_back(std::move(phrase_query));
+            }
+        }
+        size_t i = 0;
+        while (state.KeepRunning()) {
+            DoNotOptimize(search_server->FindTopDocuments(search_server->ParseQuery(queries[i++ % queries.size()], QuerySyntax::PHRASES)));
+        }
+        state.SetItemsProcessed(state.GetIterations());
+    });
+
+    // Слово словаря становится стоп-словом и снова перестаёт им быть: переиндексируются только его документы
+    runner.Register("SetStopWords/toggle"s, [&corpus, document_count](BenchmarkState& state) {
+        static std::unique_ptr<SearchServer> search_server;
+        if (!search_server) {
+            search_server = BuildServer(corpus, document_count);
+        }
+        const std::vector<std::string_view> stop_words = SplitIntoWords(corpus.stop_words);
+        size_t i = 0;
+        while (state.KeepRunning()) {
+            std::vector<std::string_view> extended_stop_words = stop_words;
+            extended_stop_words.push_back(corpus.vocabulary[1000 + (i++ * 7919) % (corpus.vocabulary.size() - 1000)]);
+            search_server->SetStopWords(extended_stop_words);
+            search_server->SetStopWords(stop_words);
+        }
+        state.SetItemsProcessed(state.GetIterations());
+    });
+
+    // Автодополнение: каждый набранный префикс слова словаря корпуса, по одному запросу на нажатие клавиши
+    runner.Register("SuggestWords/keystroke"s, [&corpus, document_count](BenchmarkState& state) {
+        static std::unique_ptr<SearchServer> search_server;
+        if (!search_server) {
+            search_server = BuildServer(corpus, document_count);
+        }
+        std::vector<std::string> patterns;
+        for (size_t word = 0; word < corpus.vocabulary.size(); word += 97) {
+            for (size_t length = 1; length <= corpus.vocabulary[word].size(); ++length) {
+                patterns.push_back(corpus.vocabulary[word].substr(0, length) + "*"s);
+            }
+        }
+        size_t i = 0;
+        while (state.KeepRunning()) {
+            DoNotOptimize(search_server->SuggestWords(patterns[i++ % patterns.size()], 10));
+        }
+        state.SetItemsProcessed(state.GetIterations());
+    });
+
+    // Запросы корпуса, в которых каждое плюс-слово может содержать опечатку
+    runner.Register("FindTopDocuments/typo"s, [&corpus, document_count](BenchmarkState& state) {
+        static std::unique_ptr<SearchServer> search_server;
+        if (!search_server) {
+            search_server = BuildServer(corpus, document_count);
+        }
+        std::vector<std::string> queries;
+        for (const std::string& query : corpus.queries) {
+            std::string typo_query;
+            for (const std::string_view word : SplitIntoWords(query)) {
+                typo_query.append(word).append(word[0] == '-' ? " "s : "~ "s);
+            }
+            queries.push_back(std::move(typo_query));
+        }
+        size_t i = 0;
+        while (state.KeepRunning()) {
+            DoNotOptimize(search_server->FindTopDocuments(search_server->ParseQuery(queries[i++ % queries.size()], QuerySyntax::PATTERNS)));
+        }
+        state.SetItemsProcessed(state.GetIterations());
+    });
+
+    const auto register_match = [&](const std::string& name, auto policy) {
+        runner.Register("MatchDocument/"s + name, [&corpus, document_count, policy](BenchmarkState& state) {
+            static std::unique_ptr<SearchServer> search_server;
+            if (!search_server) {
+                search_server = BuildServer(corpus, document_count);
+            }
+            size_t i = 0;
+            while (state.KeepRunning()) {
+                const int document_id = static_cast<int>((i * 7919) % document_count);
+                DoNotOptimize(search_server->MatchDocument(policy, corpus.queries[i++ % corpus.queries.size()], document_id));
+            }
+            state.SetItemsProcessed(state.GetIterations());
+        });
+    };
+    register_match("seq"s, std::execution::seq);
+    register_match("par"s, std::execution::par);
+
+    runner.Register("MatchDocuments/page"s, [&corpus, document_count](BenchmarkState& state) {
+        static std::unique_ptr<SearchServer> search_server;
+        if (!search_server) {
+            search_server = BuildServer(corpus, document_count);
+        }
+        // Подсветка страницы выдачи: один разобранный запрос на десяток документов
+        const size_t page_size = 10;
+        std::vector<int> document_ids(page_size);
+        DocumentMatches matches;
+        size_t i = 0;
+        while (state.KeepRunning()) {
+            const ParsedQuery query = search_server->ParseQuery(corpus.queries[i % corpus.queries.size()]);
+            for (size_t j = 0; j < page_size; ++j) {
+                document_ids[j] = static_cast<int>(((i * page_size + j) * 7919) % document_count);
+            }
+            search_server->MatchDocuments(query, document_ids, matches);
+            DoNotOptimize(matches);
+            ++i;
+        }
+        state.SetItemsProcessed(state.GetIterations() * page_size);
+    });
+
+    // Десятая страница выдачи по 10 документов: по номеру страницы и продолжением от последнего документа девятой
+    const auto register_page = [&](const std::string& name, bool use_cursor) {
+        runner.Register("FindTopDocumentsPage/"s + name, [&corpus, document_count, use_cursor](BenchmarkState& state) {
+            static std::unique_ptr<SearchServer> search_server;
+            if (!search_server) {
+                search_server = BuildServer(corpus, document_count);
+            }
+            const size_t page_index = 9;
+            const size_t page_size = 10;
+            std::vector<Document> cursors;
+            for (const std::string& query : corpus.queries) {
+                const SearchPage page = search_server->FindTopDocumentsPage(query, page_index - 1, page_size);
+                cursors.push_back(page.documents.empty() ? Document{} : page.documents.back());
+            }
+            size_t i = 0;
+            while (state.KeepRunning()) {
+                const size_t query = i % corpus.queries.size();
+                if (use_cursor) {
+                    DoNotOptimize(search_server->FindTopDocumentsAfter(corpus.queries[query], cursors[query], page_size));
+                }
+                else {
+                    DoNotOptimize(search_server->FindTopDocumentsPage(corpus.queries[query], page_index, page_size));
+                }
+                ++i;
+            }
+            state.SetItemsProcessed(state.GetIterations());
+        });
+    };
+    register_page("index"s, false);
+    register_page("cursor"s, true);
+
+    const auto register_remove = [&](const std::string& name, auto policy) {
+        runner.Register("RemoveDocument/"s + name, [&corpus, document_count, policy](BenchmarkState& state) {
+            std::unique_ptr<SearchServer> search_server;
+            size_t i = document_count;
+            while (state.KeepRunning()) {
+                if (i == document_count) {
+                    state.PauseTiming();
+                    search_server = BuildServer(corpus, document_count);
+                    i = 0;
+                    state.ResumeTiming();
+                }
+                search_server->RemoveDocument(policy, static_cast<int>(i++));
+            }
+            state.SetItemsProcessed(state.GetIterations());
+        });
+    };
+    register_remove("seq"s, std::execution::seq);
+    register_remove("par"s, std::execution::par);
+
+    runner.Register("RemoveDuplicates"s, [&corpus, document_count](BenchmarkState& state) {
+        const size_t count = std::min(document_count, DUPLICATES_DOCUMENT_COUNT);
+        std::unique_ptr<SearchServer> search_server;
+        while (state.KeepRunning()) {
+            state.PauseTiming();
+            search_server = BuildServer(corpus, count);
+            state.ResumeTiming();
+            RemoveDuplicates(*search_server);
+        }
+        state.SetItemsProcessed(state.GetIterations() * count);
+    });
+
+    runner.Register("RemoveDuplicates/near"s, [&corpus, document_count](BenchmarkState& state) {
+        const size_t count = std::min(document_count, DUPLICATES_DOCUMENT_COUNT);
+        std::unique_ptr<SearchServer> search_server;
+        while (state.KeepRunning()) {
+            state.PauseTiming();
+            search_server = BuildServer(corpus, count);
+            state.ResumeTiming();
+            RemoveNearDuplicates(*search_server);
+        }
+        state.SetItemsProcessed(state.GetIterations() * count);
+    });
+}
+
+// Поток, выбрасывающий всё записанное в него
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override {
+        return c;
+    }
+};
+
+// Значение параметра вида --name=value, если он передан
+bool ParseOption(const std::string& argument, const std::string& name, std::string& value) {
+    const std::string prefix = "--"s + name + "="s;
+    if (argument.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    value = argument.substr(prefix.size());
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+    std::string filter;
+    double min_time = 0.5;
+    std::string output_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        std::string value;
+        if (ParseOption(argument, "filter"s, value)) {
+            filter = value;
+        }
+        else if (ParseOption(argument, "min_time"s, value)) {
+            min_time = std::stod(value);
+        }
+        else if (ParseOption(argument, "documents"s, value)) {
+            options.document_count = std::stoul(value);
+        }
+        else if (ParseOption(argument, "queries"s, value)) {
+            options.query_count = std::stoul(value);
+        }
+        else if (ParseOption(argument, "seed"s, value)) {
+            options.seed = std::stoull(value);
+        }
+        else if (ParseOption(argument, "out"s, value)) {
+            output_path = value;
+        }
+        else {
+            std::cerr << "Неизвестный параметр "s << argument << std::endl;
+            return 1;
+        }
+    }
+
+    const Corpus corpus = GenerateCorpus(options);
+    BenchmarkRunner runner;
+    RegisterBenchmarks(runner, corpus);
+
+    // Замеряемый код может печатать в cout (RemoveDuplicates), а JSON должен остаться разбираемым
+    std::ostream report(std::cout.rdbuf());
+    NullBuffer null_buffer;
+    std::cout.rdbuf(&null_buffer);
+    const std::vector<BenchmarkResult> results = runner.Run(filter, std::chrono::duration<double>(min_time));
+    std::cout.rdbuf(report.rdbuf());
+
+    const std::vector<std::pair<std::string, std::string>> context = {
+        { "seed"s, std::to_string(options.seed) },
+        { "documents"s, std::to_string(options.document_count) },
+        { "queries"s, std::to_string(options.query_count) },
+        { "vocabulary_size"s, std::to_string(options.vocabulary_size) },
+        { "zipf_exponent"s, std::to_string(options.zipf_exponent) },
+        { "hardware_concurrency"s, std::to_string(std::thread::hardware_concurrency()) },
+        { "compiler"s, __VERSION__ },
+    };
+    if (output_path.empty()) {
+        PrintJson(report, context, results);
+    }
+    else {
+        std::ofstream output(output_path);
+        PrintJson(output, context, results);
+    }
+    return 0;
+}
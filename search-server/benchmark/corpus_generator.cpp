@@ -0,0 +1,118 @@
+#include "corpus_generator.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+Random::Random(uint64_t seed)
+    : state_(seed)
+{
+}
+
+uint64_t Random::Next() {
+    // splitmix64
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+uint64_t Random::NextBelow(uint64_t bound) {
+    return bound == 0 ? 0 : Next() % bound;
+}
+
+double Random::NextDouble() {
+    return static_cast<double>(Next() >> 11) * (1.0 / (1ull << 53));
+}
+
+ZipfDistribution::ZipfDistribution(size_t size, double exponent) {
+    cumulative_weights_.reserve(size);
+    double total = 0.0;
+    for (size_t rank = 0; rank < size; ++rank) {
+        total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+        cumulative_weights_.push_back(total);
+    }
+}
+
+size_t ZipfDistribution::operator()(Random& random) const {
+    const double point = random.NextDouble() * cumulative_weights_.back();
+    const auto it = std::upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), point);
+    return std::min<size_t>(it - cumulative_weights_.begin(), cumulative_weights_.size() - 1);
+}
+
+namespace {
+
+// Слово из строчных латинских букв по его номеру, разные номера дают разные слова
+std::string MakeWord(size_t number) {
+    std::string word;
+    do {
+        word.push_back(static_cast<char>('a' + number % 26));
+        number /= 26;
+    } while (number > 0);
+    return word;
+}
+
+void AppendWords(std::string& text, const std::vector<std::string>& vocabulary, const std::vector<size_t>& words) {
+    for (const size_t word : words) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        text += vocabulary[word];
+    }
+}
+
+} // namespace
+
+Corpus GenerateCorpus(const CorpusOptions& options) {
+    Random random(options.seed);
+    const ZipfDistribution zipf(options.vocabulary_size, options.zipf_exponent);
+    Corpus corpus;
+
+    corpus.vocabulary.reserve(options.vocabulary_size);
+    for (size_t i = 0; i < options.vocabulary_size; ++i) {
+        // Начиная с 26, слова не короче двух букв; частым словам достаются короткие, как в естественном языке
+        corpus.vocabulary.push_back(MakeWord(i + 26));
+    }
+    std::vector<size_t> stop_words(std::min(options.stop_word_count, options.vocabulary_size));
+    for (size_t i = 0; i < stop_words.size(); ++i) {
+        stop_words[i] = i;
+    }
+    AppendWords(corpus.stop_words, corpus.vocabulary, stop_words);
+
+    std::vector<std::vector<size_t>> document_words;
+    document_words.reserve(options.document_count);
+    for (size_t i = 0; i < options.document_count; ++i) {
+        std::vector<size_t> words;
+        if (!document_words.empty() && random.NextDouble() < options.duplicate_share) {
+            // Те же слова в другом порядке: RemoveDuplicates считает такие документы дубликатами
+            words = document_words[random.NextBelow(document_words.size())];
+            std::reverse(words.begin(), words.end());
+        }
+        else {
+            const size_t length = options.min_document_words
+                + random.NextBelow(options.max_document_words - options.min_document_words + 1);
+            for (size_t j = 0; j < length; ++j) {
+                words.push_back(zipf(random));
+            }
+        }
+        std::string text;
+        AppendWords(text, corpus.vocabulary, words);
+        corpus.documents.push_back(std::move(text));
+        corpus.ratings.push_back({ static_cast<int>(random.NextBelow(11)) - 5, static_cast<int>(random.NextBelow(11)) - 5 });
+        document_words.push_back(std::move(words));
+    }
+
+    for (size_t i = 0; i < options.query_count; ++i) {
+        std::string query;
+        const size_t plus_count = 1 + random.NextBelow(options.max_plus_words);
+        for (size_t j = 0; j < plus_count; ++j) {
+            AppendWords(query, corpus.vocabulary, { zipf(random) });
+        }
+        const size_t minus_count = random.NextBelow(options.max_minus_words + 1);
+        for (size_t j = 0; j < minus_count; ++j) {
+            query += " -"s + corpus.vocabulary[zipf(random)];
+        }
+        corpus.queries.push_back(std::move(query));
+    }
+    return corpus;
+}
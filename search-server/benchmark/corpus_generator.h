@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Воспроизводимый генератор: одинаковое зерно даёт одинаковую последовательность на любой платформе.
+// Распределения стандартной библиотеки для этого не годятся, их алгоритм зависит от реализации.
+class Random {
+public:
+    explicit Random(uint64_t seed);
+
+    uint64_t Next();
+
+    // Равномерно из [0, bound)
+    uint64_t NextBelow(uint64_t bound);
+
+    // Равномерно из [0, 1)
+    double NextDouble();
+
+private:
+    uint64_t state_;
+};
+
+// Номера слов с вероятностью, пропорциональной 1 / (номер + 1)^exponent: частые слова встречаются
+// в большинстве документов, хвост словаря — единицы раз, как в естественном тексте
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t size, double exponent);
+
+    size_t operator()(Random& random) const;
+
+private:
+    std::vector<double> cumulative_weights_;
+};
+
+struct CorpusOptions {
+    uint64_t seed = 42;
+    size_t vocabulary_size = 50000;
+    double zipf_exponent = 1.0;
+    size_t document_count = 20000;
+    size_t min_document_words = 10;
+    size_t max_document_words = 100;
+    size_t stop_word_count = 10;
+    size_t query_count = 1000;
+    size_t max_plus_words = 4;
+    size_t max_minus_words = 2;
+    // Доля документов, повторяющих набор слов одного из предыдущих документов
+    double duplicate_share = 0.1;
+};
+
+struct Corpus {
+    std::vector<std::string> vocabulary;
+    // Самые частые слова словаря
+    std::string stop_words;
+    std::vector<std::string> documents;
+    std::vector<std::vector<int>> ratings;
+    std::vector<std::string> queries;
+};
+
+Corpus GenerateCorpus(const CorpusOptions& options);
@@ -0,0 +1,48 @@
+#include "concurrent_search_server.h"
+#include <atomic>
+#include <thread>
+
+std::shared_ptr<const SearchServer> ConcurrentSearchServer::GetSnapshot() const {
+    return std::atomic_load(&published_);
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    return GetSnapshot()->GetDocumentCount();
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    Update([&](SearchServer& search_server) {
+        search_server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+std::vector<AddDocumentError> ConcurrentSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    std::vector<AddDocumentError> errors;
+    Update([&](SearchServer& search_server) {
+        errors = search_server.AddDocuments(documents);
+    });
+    return errors;
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    Update([document_id](SearchServer& search_server) {
+        search_server.RemoveDocument(document_id);
+    });
+}
+
+void ConcurrentSearchServer::Update(const std::function<void(SearchServer&)>& mutation) {
+    std::lock_guard guard(writer_mutex_);
+    // Запасную копию никто не читает: после прошлой публикации писатель дождался её читателей
+    mutation(*standby_);
+    standby_ = std::atomic_exchange(&published_, standby_);
+    WaitForReaders();
+    mutation(*standby_);
+}
+
+void ConcurrentSearchServer::WaitForReaders() const {
+    // Новые читатели прежнюю копию уже не получат, остаётся дождаться, пока её отпустят текущие
+    while (standby_.use_count() > 1) {
+        std::this_thread::yield();
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "search_server.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Сервер для одновременных чтений и записей. Хранит две копии индекса: читатели берут опубликованную
+// копию и работают с ней без блокировок, писатель меняет вторую копию, атомарно публикует её,
+// дожидается, пока читатели отпустят прежнюю, и повторяет на ней то же изменение.
+// Память под индекс удваивается, зато чтения не ждут записей и никогда не видят индекс в середине изменения.
+class ConcurrentSearchServer {
+public:
+    template <typename StopWords>
+    explicit ConcurrentSearchServer(const StopWords& stop_words);
+
+    // Неизменяемый снимок. Пока снимок удерживается, писатель не может повторно использовать эту копию,
+    // поэтому держать его нужно не дольше одного запроса.
+    std::shared_ptr<const SearchServer> GetSnapshot() const;
+
+    template <typename... Args>
+    std::vector<Document> FindTopDocuments(Args&&... args) const;
+
+    int GetDocumentCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    std::vector<AddDocumentError> AddDocuments(const std::vector<DocumentInput>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Применяет изменение к обеим копиям. Изменение выполняется дважды, поэтому должно давать
+    // одинаковый результат на одинаковых копиях, а при исключении оставлять сервер нетронутым.
+    void Update(const std::function<void(SearchServer&)>& mutation);
+
+private:
+    std::shared_ptr<SearchServer> published_;
+    std::shared_ptr<SearchServer> standby_;
+    std::mutex writer_mutex_;
+
+    void WaitForReaders() const;
+};
+
+template <typename StopWords>
+ConcurrentSearchServer::ConcurrentSearchServer(const StopWords& stop_words)
+    : published_(std::make_shared<SearchServer>(stop_words))
+    , standby_(std::make_shared<SearchServer>(stop_words))
+{
+}
+
+template <typename... Args>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(Args&&... args) const {
+    return GetSnapshot()->FindTopDocuments(std::forward<Args>(args)...);
+}
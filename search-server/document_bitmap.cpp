@@ -0,0 +1,37 @@
+#include "document_bitmap.h"
+#include <algorithm>
+
+using namespace std;
+
+void DocumentBitmap::Set(int document_index) {
+    const size_t word = static_cast<size_t>(document_index) / 64;
+    if (word >= words_.size()) {
+        words_.resize(word + 1);
+    }
+    words_[word] |= uint64_t(1) << (document_index % 64);
+}
+
+void DocumentBitmap::Reset(int document_index) {
+    const size_t word = static_cast<size_t>(document_index) / 64;
+    if (word < words_.size()) {
+        words_[word] &= ~(uint64_t(1) << (document_index % 64));
+    }
+}
+
+bool DocumentBitmap::AnyInRange(int first, int last) const {
+    const size_t first_word = static_cast<size_t>(first) / 64;
+    if (first_word >= words_.size() || first > last) {
+        return false;
+    }
+    const size_t last_word = std::min(static_cast<size_t>(last) / 64, words_.size() - 1);
+    // Маски отрезают биты левее first в первом слове и правее last в последнем
+    const uint64_t first_mask = ~uint64_t(0) << (first % 64);
+    const uint64_t last_mask = static_cast<size_t>(last) / 64 == last_word ? ~uint64_t(0) >> (63 - last % 64) : ~uint64_t(0);
+    if (first_word == last_word) {
+        return (words_[first_word] & first_mask & last_mask) != 0;
+    }
+    if ((words_[first_word] & first_mask) != 0 || (words_[last_word] & last_mask) != 0) {
+        return true;
+    }
+    return std::any_of(words_.begin() + first_word + 1, words_.begin() + last_word, [](uint64_t word) { return word != 0; });
+}
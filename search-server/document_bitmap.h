@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Множество внутренних индексов документов, по биту на индекс.
+// Проверка документа — чтение одного бита, а пустоту диапазона индексов
+// можно проверить словами по 64 индекса, не перебирая документы.
+class DocumentBitmap {
+public:
+    void Set(int document_index);
+
+    void Reset(int document_index);
+
+    bool Test(int document_index) const {
+        const size_t word = static_cast<size_t>(document_index) / 64;
+        return word < words_.size() && (words_[word] >> (document_index % 64) & 1) != 0;
+    }
+
+    // Есть ли в множестве хоть один индекс из [first, last]
+    bool AnyInRange(int first, int last) const;
+
+private:
+    std::vector<uint64_t> words_;
+};
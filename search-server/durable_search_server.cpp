@@ -0,0 +1,279 @@
+#include "durable_search_server.h"
+#include "index_snapshot.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace std;
+
+namespace {
+
+const std::string SNAPSHOT_PREFIX = "snapshot-"s;
+const std::string LOG_NAME = "wal"s;
+
+enum class LogOperation : uint8_t {
+    ADD_DOCUMENT,
+    ADD_DOCUMENTS,
+    REMOVE_DOCUMENT,
+};
+
+template <typename Value>
+void WriteValue(std::string& record, Value value) {
+    static_assert(std::is_trivially_copyable_v<Value>);
+    record.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Поля документа до текста. Текст в записи идёт сразу за ними и передаётся в журнал отдельной частью,
+// чтобы не копировать его в буфер записи
+void WriteDocumentFields(std::string& record, int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    WriteValue<int32_t>(record, document_id);
+    WriteValue(record, status);
+    WriteValue<uint32_t>(record, static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        WriteValue<int32_t>(record, rating);
+    }
+    WriteValue<uint64_t>(record, document.size());
+}
+
+class RecordReader {
+public:
+    explicit RecordReader(std::string_view data)
+        : data_(data)
+    {
+    }
+
+    template <typename Value>
+    Value Read() {
+        static_assert(std::is_trivially_copyable_v<Value>);
+        Value value;
+        std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+
+    // Текст ссылается на запись журнала и живёт, пока она прочитана в память
+    DocumentInput ReadDocument() {
+        DocumentInput document;
+        document.id = Read<int32_t>();
+        document.status = Read<DocumentStatus>();
+        document.ratings.resize(Read<uint32_t>());
+        for (int& rating : document.ratings) {
+            rating = Read<int32_t>();
+        }
+        document.text = Take(Read<uint64_t>());
+        return document;
+    }
+
+private:
+    std::string_view data_;
+
+    std::string_view Take(size_t size) {
+        if (data_.size() < size) {
+            throw std::runtime_error("Повреждённая запись журнала"s);
+        }
+        const std::string_view result = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return result;
+    }
+};
+
+// Номер снимка по имени файла; временные и посторонние файлы не подходят
+std::optional<uint64_t> ParseSnapshotSequence(const std::string& file_name) {
+    if (file_name.compare(0, SNAPSHOT_PREFIX.size(), SNAPSHOT_PREFIX) != 0 || file_name.size() == SNAPSHOT_PREFIX.size()) {
+        return std::nullopt;
+    }
+    uint64_t sequence = 0;
+    for (size_t i = SNAPSHOT_PREFIX.size(); i < file_name.size(); ++i) {
+        if (file_name[i] < '0' || file_name[i] > '9') {
+            return std::nullopt;
+        }
+        sequence = sequence * 10 + (file_name[i] - '0');
+    }
+    return sequence;
+}
+
+// Номера всех снимков каталога
+std::vector<uint64_t> FindSnapshots(const std::string& directory) {
+    std::vector<uint64_t> sequences;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (const auto sequence = ParseSnapshotSequence(entry.path().filename().string())) {
+            sequences.push_back(*sequence);
+        }
+    }
+    std::sort(sequences.begin(), sequences.end());
+    return sequences;
+}
+
+} // namespace
+
+DurableSearchServer::DurableSearchServer(const std::string& directory, std::string_view stop_words_text, DurabilityOptions options)
+    : directory_(directory)
+    , options_(options)
+{
+    std::filesystem::create_directories(directory_);
+    const std::vector<uint64_t> snapshots = FindSnapshots(directory_);
+    if (snapshots.empty()) {
+        search_server_ = std::make_unique<SearchServer>(stop_words_text);
+    }
+    else {
+        snapshot_sequence_ = snapshots.back();
+        search_server_ = std::make_unique<SearchServer>(LoadSearchServer(GetSnapshotPath(snapshot_sequence_)));
+    }
+    // Записи не новее снимка остаются в журнале, если процесс упал между сохранением снимка и сбросом журнала
+    log_ = std::make_unique<WriteAheadLog>(directory_ + "/"s + LOG_NAME, snapshot_sequence_ + 1,
+        [this](uint64_t sequence, std::string_view record) {
+            if (sequence > snapshot_sequence_) {
+                Replay(record);
+            }
+        },
+        options_.log);
+}
+
+void DurableSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    // Документ проверяет сам сервер, поэтому добавление применяется до записи в журнал, а если журнал запись
+    // не принял, откатывается. В журнале только принятые сервером изменения, а в сервере — только записанные в журнал.
+    search_server_->AddDocument(document_id, document, status, ratings);
+    record_.clear();
+    WriteValue(record_, LogOperation::ADD_DOCUMENT);
+    WriteDocumentFields(record_, document_id, document, status, ratings);
+    record_parts_.assign({ record_, document });
+    uint64_t sequence = 0;
+    try {
+        sequence = log_->Append(record_parts_);
+    }
+    catch (...) {
+        search_server_->RemoveDocument(document_id);
+        throw;
+    }
+    Commit(sequence);
+}
+
+std::vector<AddDocumentError> DurableSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    std::vector<AddDocumentError> errors = search_server_->AddDocuments(documents);
+    if (errors.size() == documents.size()) {
+        return errors;
+    }
+    // На том же состоянии сервера пакет отклонит те же документы, поэтому пишется целиком
+    record_.clear();
+    WriteValue(record_, LogOperation::ADD_DOCUMENTS);
+    WriteValue<uint64_t>(record_, documents.size());
+    // Части записи ссылаются на record_, поэтому собираются, когда он уже заполнен
+    std::vector<size_t> field_ends;
+    field_ends.reserve(documents.size());
+    for (const DocumentInput& document : documents) {
+        WriteDocumentFields(record_, document.id, document.text, document.status, document.ratings);
+        field_ends.push_back(record_.size());
+    }
+    record_parts_.clear();
+    size_t fields_begin = 0;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        record_parts_.push_back(std::string_view(record_).substr(fields_begin, field_ends[i] - fields_begin));
+        record_parts_.push_back(documents[i].text);
+        fields_begin = field_ends[i];
+    }
+    record_parts_.push_back(std::string_view(record_).substr(fields_begin));
+    uint64_t sequence = 0;
+    try {
+        sequence = log_->Append(record_parts_);
+    }
+    catch (...) {
+        // Из документов с одним id добавляется не больше одного, а остальные получают ошибку,
+        // поэтому добавлены те id, которые встречаются в пакете чаще, чем в ошибках
+        std::map<int, int> added_counts;
+        for (const DocumentInput& document : documents) {
+            ++added_counts[document.id];
+        }
+        for (const AddDocumentError& error : errors) {
+            --added_counts[error.document_id];
+        }
+        for (const auto [document_id, added_count] : added_counts) {
+            if (added_count > 0) {
+                search_server_->RemoveDocument(document_id);
+            }
+        }
+        throw;
+    }
+    Commit(sequence);
+    return errors;
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    // Удаление существующего документа не отказывает, поэтому порядок обычный: проверка, журнал, сервер
+    if (search_server_->document_indexes_.count(document_id) == 0) {
+        throw std::out_of_range("Документа с таким id нет"s);
+    }
+    record_.clear();
+    WriteValue(record_, LogOperation::REMOVE_DOCUMENT);
+    WriteValue<int32_t>(record_, document_id);
+    record_parts_.assign({ record_ });
+    const uint64_t sequence = log_->Append(record_parts_);
+    search_server_->RemoveDocument(document_id);
+    Commit(sequence);
+}
+
+void DurableSearchServer::Sync() {
+    log_->Sync();
+}
+
+void DurableSearchServer::Checkpoint() {
+    log_->Sync();
+    const uint64_t sequence = log_->GetLastSequence();
+    if (sequence == snapshot_sequence_) {
+        return;
+    }
+    // Сначала появляется новый снимок, и только потом сбрасывается журнал и удаляются старые снимки:
+    // после падения на любом шаге остаётся снимок и журнал, дающие текущее состояние
+    SaveSnapshot(*search_server_, GetSnapshotPath(sequence));
+    log_->Reset();
+    snapshot_sequence_ = sequence;
+    for (const uint64_t old_sequence : FindSnapshots(directory_)) {
+        if (old_sequence < sequence) {
+            std::filesystem::remove(GetSnapshotPath(old_sequence));
+        }
+    }
+}
+
+const SearchServer& DurableSearchServer::GetSearchServer() const {
+    return *search_server_;
+}
+
+std::string DurableSearchServer::GetSnapshotPath(uint64_t sequence) const {
+    return directory_ + "/"s + SNAPSHOT_PREFIX + std::to_string(sequence);
+}
+
+void DurableSearchServer::Commit(uint64_t sequence) {
+    if (options_.wait_for_sync) {
+        log_->WaitDurable(sequence);
+    }
+    if (options_.checkpoint_bytes > 0 && log_->GetSize() >= options_.checkpoint_bytes) {
+        Checkpoint();
+    }
+}
+
+void DurableSearchServer::Replay(std::string_view record) {
+    RecordReader reader(record);
+    switch (reader.Read<LogOperation>()) {
+    case LogOperation::ADD_DOCUMENT: {
+        const DocumentInput document = reader.ReadDocument();
+        search_server_->AddDocument(document.id, document.text, document.status, document.ratings);
+        break;
+    }
+    case LogOperation::ADD_DOCUMENTS: {
+        std::vector<DocumentInput> documents(reader.Read<uint64_t>());
+        for (DocumentInput& document : documents) {
+            document = reader.ReadDocument();
+        }
+        search_server_->AddDocuments(documents);
+        break;
+    }
+    case LogOperation::REMOVE_DOCUMENT:
+        search_server_->RemoveDocument(reader.Read<int32_t>());
+        break;
+    default:
+        throw std::runtime_error("Неизвестная операция в журнале"s);
+    }
+}
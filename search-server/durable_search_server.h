@@ -0,0 +1,60 @@
+#pragma once
+#include "search_server.h"
+#include "write_ahead_log.h"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct DurabilityOptions {
+    WriteAheadLogOptions log;
+    // Возвращать управление из изменяющих методов только после того, как их запись попала на диск.
+    // Без этого при падении машины теряются изменения последних log.sync_interval.
+    bool wait_for_sync = false;
+    // Когда журнал дорастает до этого размера, изменение делает чекпойнт; 0 — чекпойнты только вручную
+    uint64_t checkpoint_bytes = 256 * 1024 * 1024;
+};
+
+// Сервер, переживающий падение процесса и машины. Каждое успешное добавление и удаление
+// записывается в журнал directory/wal. Чекпойнт сохраняет снимок directory/snapshot-<номер последней записи>
+// и начинает журнал заново. При создании сервер загружает последний снимок и применяет к нему
+// только записи журнала новее снимка.
+// Изменять сервер может один поток, как и обычный SearchServer.
+class DurableSearchServer {
+public:
+    // Стоп-слова используются, только если в каталоге ещё нет снимка, иначе берутся из снимка
+    DurableSearchServer(const std::string& directory, std::string_view stop_words_text, DurabilityOptions options = {});
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Весь пакет записывается в журнал одной записью и при восстановлении добавляется тем же AddDocuments
+    std::vector<AddDocumentError> AddDocuments(const std::vector<DocumentInput>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Дожидается, пока на диске не окажутся все сделанные изменения
+    void Sync();
+
+    void Checkpoint();
+
+    const SearchServer& GetSearchServer() const;
+
+private:
+    std::string directory_;
+    DurabilityOptions options_;
+    std::unique_ptr<SearchServer> search_server_;
+    // Номер последней записи журнала, вошедшей в снимок
+    uint64_t snapshot_sequence_ = 0;
+    std::unique_ptr<WriteAheadLog> log_;
+    // Буфер записи журнала без текстов документов и части записи: поля из record_ вперемешку с текстами.
+    // Переиспользуются между изменениями.
+    std::string record_;
+    std::vector<std::string_view> record_parts_;
+
+    std::string GetSnapshotPath(uint64_t sequence) const;
+
+    // Завершает изменение, уже записанное в журнал под номером sequence: при необходимости ждёт диска и делает чекпойнт
+    void Commit(uint64_t sequence);
+
+    void Replay(std::string_view record);
+};
@@ -0,0 +1,358 @@
+#include "index_snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::literals;
+
+namespace {
+    const char MAGIC[8] = { 'S', 'R', 'C', 'H', 'S', 'N', 'P', '\0' };
+
+    static_assert(sizeof(snapshot::PostingRecord) % 8 == 0, "Записи снимка выровнены по 8 байт");
+
+    void SyncPath(const std::string& path, int flags) {
+        const int fd = open(path.c_str(), flags);
+        if (fd < 0) {
+            throw std::runtime_error("Не удалось открыть "s + path);
+        }
+        const int result = fsync(fd);
+        close(fd);
+        if (result != 0) {
+            throw std::runtime_error("Не удалось записать на диск "s + path);
+        }
+    }
+
+    template <typename Record>
+    void WriteRecords(std::ofstream& out, const std::vector<Record>& records) {
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    }
+}
+
+void SaveSnapshot(const SearchServer& search_server, const std::string& path) {
+    using namespace snapshot;
+
+    // Удалённые документы в снимок не попадают, оставшиеся нумеруются заново с сохранением порядка,
+    // поэтому списки документов остаются отсортированными
+    std::vector<int> new_indexes(search_server.documents_.size(), -1);
+    std::vector<int> old_indexes;
+    for (const auto [document_id, document_index] : search_server.document_indexes_) {
+        old_indexes.push_back(document_index);
+    }
+    std::sort(old_indexes.begin(), old_indexes.end());
+    for (size_t i = 0; i < old_indexes.size(); ++i) {
+        new_indexes[old_indexes[i]] = static_cast<int>(i);
+    }
+
+    uint64_t strings_size = 0;
+    const auto add_string = [&strings_size](std::string_view text) {
+        const StringRecord record{ strings_size, text.size() };
+        strings_size += text.size();
+        return record;
+    };
+
+    std::vector<std::pair<std::string_view, InvertedIndex::TermId>> terms;
+    for (InvertedIndex::TermId term_id = 0; term_id < static_cast<InvertedIndex::TermId>(search_server.index_.GetTermCount()); ++term_id) {
+        if (!search_server.index_.GetPostings(term_id).empty()) {
+            terms.push_back({ search_server.index_.GetTerm(term_id), term_id });
+        }
+    }
+    std::sort(terms.begin(), terms.end());
+    std::vector<TermRecord> term_records;
+    uint64_t posting_count = 0;
+    for (const auto& [term, term_id] : terms) {
+        const uint64_t term_posting_count = search_server.index_.GetPostings(term_id).size();
+        term_records.push_back({ add_string(term), posting_count, term_posting_count });
+        posting_count += term_posting_count;
+    }
+
+    std::vector<std::pair<std::string_view, InvertedIndex::TermId>> stop_words;
+    for (const std::string& stop_word : search_server.stop_words_) {
+        stop_words.push_back({ stop_word, search_server.stop_word_index_.FindTerm(stop_word) });
+    }
+    std::sort(stop_words.begin(), stop_words.end());
+    std::vector<TermRecord> stop_word_records;
+    for (const auto& [stop_word, term_id] : stop_words) {
+        const uint64_t term_posting_count = term_id == InvertedIndex::NO_TERM ? 0 : search_server.stop_word_index_.GetPostings(term_id).size();
+        stop_word_records.push_back({ add_string(stop_word), posting_count, term_posting_count });
+        posting_count += term_posting_count;
+    }
+
+    std::vector<DocumentRecord> document_records;
+    for (const int document_index : old_indexes) {
+        const auto& document_data = search_server.documents_[document_index];
+        document_records.push_back({ document_data.id, document_data.rating, static_cast<int32_t>(document_data.status), 0,
+            add_string(document_data.text) });
+    }
+
+    std::vector<IdRecord> id_records;
+    for (const auto [document_id, document_index] : search_server.document_indexes_) {
+        id_records.push_back({ document_id, new_indexes[document_index] });
+    }
+
+    Header header{};
+    std::copy(std::begin(MAGIC), std::end(MAGIC), header.magic);
+    header.version = VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    header.document_count = document_records.size();
+    header.documents_offset = sizeof(Header);
+    header.ids_offset = header.documents_offset + document_records.size() * sizeof(DocumentRecord);
+    header.term_count = term_records.size();
+    header.terms_offset = header.ids_offset + id_records.size() * sizeof(IdRecord);
+    header.posting_count = posting_count;
+    header.postings_offset = header.terms_offset + term_records.size() * sizeof(TermRecord);
+    header.stop_word_count = stop_word_records.size();
+    header.stop_words_offset = header.postings_offset + posting_count * sizeof(PostingRecord);
+    header.strings_offset = header.stop_words_offset + stop_word_records.size() * sizeof(TermRecord);
+    header.strings_size = strings_size;
+    header.file_size = header.strings_offset + strings_size;
+
+    const std::string temp_path = path + ".tmp"s;
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Не удалось создать файл снимка "s + temp_path);
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        WriteRecords(out, document_records);
+        WriteRecords(out, id_records);
+        WriteRecords(out, term_records);
+        const auto write_postings = [&out, &new_indexes](const PostingList& postings) {
+            for (PostingCursor cursor(postings); !cursor.IsEnd(); cursor.Next()) {
+                const PostingRecord renumbered{ new_indexes[cursor.GetDocumentIndex()], cursor.GetTermCount(), cursor.GetDocumentLength(), 0 };
+                out.write(reinterpret_cast<const char*>(&renumbered), sizeof(renumbered));
+            }
+        };
+        for (const auto& [term, term_id] : terms) {
+            write_postings(search_server.index_.GetPostings(term_id));
+        }
+        for (const auto& [stop_word, term_id] : stop_words) {
+            if (term_id != InvertedIndex::NO_TERM) {
+                write_postings(search_server.stop_word_index_.GetPostings(term_id));
+            }
+        }
+        WriteRecords(out, stop_word_records);
+        for (const auto& [term, _] : terms) {
+            out.write(term.data(), term.size());
+        }
+        for (const auto& [stop_word, _] : stop_words) {
+            out.write(stop_word.data(), stop_word.size());
+        }
+        for (const int document_index : old_indexes) {
+            const std::string_view text = search_server.documents_[document_index].text;
+            out.write(text.data(), text.size());
+        }
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Не удалось записать снимок "s + temp_path);
+        }
+    }
+    // Снимок должен оказаться на диске до переименования, а само переименование — после синхронизации каталога,
+    // иначе после падения машины на месте снимка может оказаться пустой файл
+    SyncPath(temp_path, O_RDONLY);
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Не удалось заменить снимок "s + path);
+    }
+    const size_t slash = path.rfind('/');
+    SyncPath(slash == std::string::npos ? "."s : slash == 0 ? "/"s : path.substr(0, slash), O_RDONLY | O_DIRECTORY);
+}
+
+SearchServer LoadSearchServer(const std::string& path) {
+    const MappedSearchServer mapped(path);
+    SearchServer search_server(mapped.stop_words_);
+    const auto corrupted = [&path]() {
+        return std::invalid_argument("Снимок "s + path + " повреждён"s);
+    };
+
+    // Внутренние индексы документов в снимке идут подряд с нуля, поэтому сохраняются как есть,
+    // и списки документов переносятся в индекс в том же порядке без пересортировки
+    const uint64_t document_count = mapped.header_->document_count;
+    for (uint64_t i = 0; i < document_count; ++i) {
+        const auto& document = mapped.documents_[i];
+        if (document.id < 0 || document.status < 0 || document.status >= static_cast<int32_t>(DOCUMENT_STATUS_COUNT)
+            || !search_server.document_indexes_.emplace(document.id, static_cast<int>(i)).second) {
+            throw corrupted();
+        }
+        const std::string_view text = search_server.document_texts_.Store(mapped.GetString(document.text));
+        search_server.documents_.push_back({ document.id, document.rating, static_cast<DocumentStatus>(document.status), text });
+        search_server.id_word_freqs_[document.id];
+        search_server.UpdateFilterBitmaps(static_cast<int>(i), true);
+        search_server.docs_id_.insert(document.id);
+    }
+
+    // Границы списков и индексы документов в них проверены при открытии снимка
+    const auto for_each_posting = [&mapped, &corrupted](const snapshot::TermRecord& term, const auto& callback) {
+        int previous_document_index = -1;
+        for (uint64_t j = term.first_posting; j < term.first_posting + term.posting_count; ++j) {
+            const snapshot::PostingRecord& posting = mapped.postings_[j];
+            if (posting.document_index <= previous_document_index || posting.term_count == 0 || posting.term_count > posting.document_length) {
+                throw corrupted();
+            }
+            previous_document_index = posting.document_index;
+            callback(posting);
+        }
+    };
+    for (uint64_t i = 0; i < mapped.header_->term_count; ++i) {
+        const auto& term = mapped.terms_[i];
+        // Слова в снимке различны, поэтому получают идентификаторы по порядку
+        const InvertedIndex::TermId term_id = search_server.index_.AddTerm(mapped.GetString(term.text));
+        if (static_cast<uint64_t>(term_id) != i) {
+            throw corrupted();
+        }
+        const std::string_view word = search_server.index_.GetTerm(term_id);
+        for_each_posting(term, [&](const snapshot::PostingRecord& posting) {
+            search_server.index_.AddPosting(term_id, posting.document_index, posting.term_count, posting.document_length);
+            search_server.id_word_freqs_[mapped.documents_[posting.document_index].id].emplace(word,
+                ComputeTermFreq(posting.term_count, posting.document_length));
+        });
+    }
+    for (uint64_t i = 0; i < mapped.header_->stop_word_count; ++i) {
+        const auto& stop_word = mapped.stop_word_terms_[i];
+        const InvertedIndex::TermId term_id = search_server.stop_word_index_.AddTerm(mapped.GetString(stop_word.text));
+        for_each_posting(stop_word, [&](const snapshot::PostingRecord& posting) {
+            search_server.stop_word_index_.AddPosting(term_id, posting.document_index, posting.term_count, posting.document_length);
+        });
+    }
+    search_server.generation_ = document_count;
+    return search_server;
+}
+
+MappedSearchServer::MappedSearchServer(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Не удалось открыть снимок "s + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("Не удалось прочитать размер снимка "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ < sizeof(snapshot::Header)) {
+        close(fd);
+        throw std::invalid_argument("Файл "s + path + " не является снимком индекса"s);
+    }
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Не удалось отобразить снимок "s + path);
+    }
+    data_ = static_cast<const char*>(data);
+    header_ = reinterpret_cast<const snapshot::Header*>(data_);
+
+    // Сначала проверяются заголовок и границы секций
+    const auto section_fits = [this](uint64_t offset, uint64_t count, size_t record_size) {
+        return offset % 8 == 0 && offset <= size_ && count <= (size_ - offset) / record_size;
+    };
+    if (!std::equal(std::begin(MAGIC), std::end(MAGIC), header_->magic)
+        || header_->version != snapshot::VERSION
+        || header_->byte_order_mark != snapshot::BYTE_ORDER_MARK
+        || header_->file_size != size_
+        || !section_fits(header_->documents_offset, header_->document_count, sizeof(snapshot::DocumentRecord))
+        || !section_fits(header_->ids_offset, header_->document_count, sizeof(snapshot::IdRecord))
+        || !section_fits(header_->terms_offset, header_->term_count, sizeof(snapshot::TermRecord))
+        || !section_fits(header_->postings_offset, header_->posting_count, sizeof(snapshot::PostingRecord))
+        || !section_fits(header_->stop_words_offset, header_->stop_word_count, sizeof(snapshot::TermRecord))
+        || header_->strings_offset > size_ || header_->strings_size > size_ - header_->strings_offset) {
+        munmap(data, size_);
+        throw std::invalid_argument("Снимок "s + path + " повреждён или записан другой версией"s);
+    }
+    documents_ = reinterpret_cast<const snapshot::DocumentRecord*>(data_ + header_->documents_offset);
+    ids_ = reinterpret_cast<const snapshot::IdRecord*>(data_ + header_->ids_offset);
+    terms_ = reinterpret_cast<const snapshot::TermRecord*>(data_ + header_->terms_offset);
+    postings_ = reinterpret_cast<const snapshot::PostingRecord*>(data_ + header_->postings_offset);
+    stop_word_terms_ = reinterpret_cast<const snapshot::TermRecord*>(data_ + header_->stop_words_offset);
+
+    // Поиск обращается к таблице документов по записям id и спискам документов без проверок, поэтому эти записи
+    // и границы списков проверяются один раз здесь. Строки и записи документов по-прежнему читаются лениво.
+    const auto is_document_index = [this](int32_t document_index) {
+        return document_index >= 0 && static_cast<uint64_t>(document_index) < header_->document_count;
+    };
+    const auto is_posting_range = [this](const snapshot::TermRecord& term) {
+        return term.first_posting <= header_->posting_count && term.posting_count <= header_->posting_count - term.first_posting;
+    };
+    if (!std::all_of(ids_, ids_ + header_->document_count, [&](const snapshot::IdRecord& record) { return is_document_index(record.document_index); })
+        || !std::all_of(postings_, postings_ + header_->posting_count, [&](const snapshot::PostingRecord& record) { return is_document_index(record.document_index); })
+        || !std::all_of(terms_, terms_ + header_->term_count, is_posting_range)
+        || !std::all_of(stop_word_terms_, stop_word_terms_ + header_->stop_word_count, is_posting_range)) {
+        munmap(data, size_);
+        throw std::invalid_argument("Снимок "s + path + " ссылается на несуществующие документы"s);
+    }
+
+    std::vector<std::string_view> stop_words;
+    for (uint64_t i = 0; i < header_->stop_word_count; ++i) {
+        stop_words.push_back(GetString(stop_word_terms_[i].text));
+    }
+    stop_words_ = StopWordSet(stop_words);
+}
+
+MappedSearchServer::~MappedSearchServer() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(raw_query, document_filter::Status{ status }, top_count);
+}
+
+int MappedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(header_->document_count);
+}
+
+std::string_view MappedSearchServer::GetDocumentText(int document_id) const {
+    const auto* ids_end = ids_ + header_->document_count;
+    const auto it = std::lower_bound(ids_, ids_end, document_id,
+        [](const snapshot::IdRecord& record, int id) { return record.id < id; });
+    if (it == ids_end || it->id != document_id) {
+        throw std::out_of_range("No document with id "s + std::to_string(document_id));
+    }
+    return GetString(documents_[it->document_index].text);
+}
+
+std::string_view MappedSearchServer::GetString(const snapshot::StringRecord& record) const {
+    if (record.offset > header_->strings_size || record.size > header_->strings_size - record.offset) {
+        throw std::out_of_range("Строка выходит за границы снимка"s);
+    }
+    return { data_ + header_->strings_offset + record.offset, record.size };
+}
+
+const snapshot::TermRecord* MappedSearchServer::FindTerm(std::string_view word) const {
+    const auto* terms_end = terms_ + header_->term_count;
+    const auto it = std::lower_bound(terms_, terms_end, word,
+        [this](const snapshot::TermRecord& record, std::string_view text) { return GetString(record.text) < text; });
+    if (it == terms_end || GetString(it->text) != word) {
+        return nullptr;
+    }
+    return it;
+}
+
+// Правила разбора SearchServer::ParseQuery с QuerySyntax::PLAIN: *, ?, ~ и кавычки — обычные символы слова.
+MappedSearchServer::Query MappedSearchServer::ParseQuery(std::string_view text) const {
+    Query query;
+    const bool is_valid = ForEachWord(text, [this, &query](std::string_view word) {
+        bool is_minus = false;
+        if (word[0] == '-') {
+            is_minus = true;
+            word.remove_prefix(1);
+        }
+        if (word.empty() || word[0] == '-') {
+            throw std::invalid_argument("Невалидный поисковый запрос"s);
+        }
+        if (!stop_words_.Contains(word)) {
+            (is_minus ? query.minus_words : query.plus_words).push_back(word);
+        }
+    });
+    if (!is_valid) {
+        throw std::invalid_argument("В поисковом запросе недопустимые символы"s);
+    }
+    for (auto* words : { &query.plus_words, &query.minus_words }) {
+        std::sort(words->begin(), words->end());
+        words->erase(std::unique(words->begin(), words->end()), words->end());
+    }
+    return query;
+}
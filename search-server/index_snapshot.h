@@ -0,0 +1,178 @@
+#pragma once
+#include "search_server.h"
+#include "relevance_accumulator.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Двоичный снимок индекса. Все числа записаны в порядке байт машины, которая сохранила снимок,
+// секции выровнены по 8 байт. Строки (слова, стоп-слова и тексты документов) лежат в общем блоке,
+// записи ссылаются на них смещением от начала блока.
+namespace snapshot {
+    const uint32_t VERSION = 3;
+    const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order_mark;
+        uint64_t file_size;
+        uint64_t document_count;
+        uint64_t documents_offset;
+        uint64_t ids_offset;
+        uint64_t term_count;
+        uint64_t terms_offset;
+        uint64_t posting_count;
+        uint64_t postings_offset;
+        uint64_t stop_word_count;
+        uint64_t stop_words_offset;
+        uint64_t strings_offset;
+        uint64_t strings_size;
+    };
+
+    struct StringRecord {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // Документы лежат в порядке внутренних индексов, на эти индексы ссылаются записи PostingRecord
+    struct DocumentRecord {
+        int32_t id;
+        int32_t rating;
+        int32_t status;
+        uint32_t reserved;
+        StringRecord text;
+    };
+
+    // Для поиска документа по id, отсортированы по id
+    struct IdRecord {
+        int32_t id;
+        int32_t document_index;
+    };
+
+    // Документ слова. Частота хранится теми же целыми, что и в PostingList, поэтому сервер из снимка
+    // собирается без потери точности. Записи слова отсортированы по document_index.
+    struct PostingRecord {
+        int32_t document_index;
+        uint32_t term_count;
+        uint32_t document_length;
+        uint32_t reserved;
+    };
+
+    // Отсортированы по тексту слова. Стоп-слова записаны так же: их списки документов лежат
+    // в секции документов слов после списков обычных слов и нужны только для замены стоп-слов
+    struct TermRecord {
+        StringRecord text;
+        uint64_t first_posting;
+        uint64_t posting_count;
+    };
+}
+
+// Сохраняет документы, стоп-слова и индекс сервера. Файл сначала пишется рядом и затем переименовывается,
+// поэтому прерванная запись не портит предыдущий снимок.
+void SaveSnapshot(const SearchServer& search_server, const std::string& path);
+
+// Читает снимок целиком и строит из него обычный изменяемый сервер прямо по словарю, спискам документов
+// и записям документов, не разбирая тексты заново
+SearchServer LoadSearchServer(const std::string& path);
+
+// Сервер только для чтения поверх отображённого в память снимка.
+// Запросы обслуживаются прямо из страниц файла, словарь и списки документов не копируются в кучу.
+// Запрос разбирается как у SearchServer с QuerySyntax::PLAIN; фраз в кавычках нет, потому что снимок не хранит позиций.
+class MappedSearchServer {
+public:
+    explicit MappedSearchServer(const std::string& path);
+
+    MappedSearchServer(const MappedSearchServer&) = delete;
+    MappedSearchServer& operator=(const MappedSearchServer&) = delete;
+
+    ~MappedSearchServer();
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    int GetDocumentCount() const;
+
+    std::string_view GetDocumentText(int document_id) const;
+
+private:
+    friend SearchServer LoadSearchServer(const std::string& path);
+
+    struct Query {
+        std::vector<std::string_view> plus_words;
+        std::vector<std::string_view> minus_words;
+    };
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    const snapshot::Header* header_ = nullptr;
+    const snapshot::DocumentRecord* documents_ = nullptr;
+    const snapshot::IdRecord* ids_ = nullptr;
+    const snapshot::TermRecord* terms_ = nullptr;
+    const snapshot::PostingRecord* postings_ = nullptr;
+    const snapshot::TermRecord* stop_word_terms_ = nullptr;
+    StopWordSet stop_words_;
+
+    std::string_view GetString(const snapshot::StringRecord& record) const;
+
+    const snapshot::TermRecord* FindTerm(std::string_view word) const;
+
+    Query ParseQuery(std::string_view text) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> MappedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    const Query query = ParseQuery(raw_query);
+    // Ячейка накопителя — индекс документа в снимке, как у SearchServer
+    RelevanceAccumulator accumulator(header_->document_count, header_->document_count);
+    for (const auto& word : query.plus_words) {
+        const snapshot::TermRecord* term = FindTerm(word);
+        if (term == nullptr) {
+            continue;
+        }
+        const double inverse_document_freq = std::log(GetDocumentCount() * 1.0 / term->posting_count);
+        for (const snapshot::PostingRecord* posting = postings_ + term->first_posting; posting != postings_ + term->first_posting + term->posting_count; ++posting) {
+            const int document_index = posting->document_index;
+            if (accumulator.GetState(document_index) == RelevanceAccumulator::State::UNSEEN) {
+                const auto& document = documents_[document_index];
+                if (document_predicate(document.id, static_cast<DocumentStatus>(document.status), document.rating)) {
+                    accumulator.Match(document_index);
+                }
+                else {
+                    accumulator.Exclude(document_index);
+                }
+            }
+            if (accumulator.GetState(document_index) == RelevanceAccumulator::State::MATCHED) {
+                accumulator.Add(document_index, ComputeTermFreq(posting->term_count, posting->document_length) * inverse_document_freq);
+            }
+        }
+    }
+
+    // Исключаются только уже найденные документы, чтобы не трогать лишние ячейки накопителя
+    for (const auto& word : query.minus_words) {
+        const snapshot::TermRecord* term = FindTerm(word);
+        if (term == nullptr) {
+            continue;
+        }
+        for (const snapshot::PostingRecord* posting = postings_ + term->first_posting; posting != postings_ + term->first_posting + term->posting_count; ++posting) {
+            if (accumulator.GetState(posting->document_index) == RelevanceAccumulator::State::MATCHED) {
+                accumulator.Exclude(posting->document_index);
+            }
+        }
+    }
+
+    TopDocuments top_documents(top_count);
+    for (const size_t document_index : accumulator.GetTouchedSlots()) {
+        if (accumulator.GetState(document_index) != RelevanceAccumulator::State::MATCHED) {
+            continue;
+        }
+        const auto& document = documents_[document_index];
+        top_documents.Add({ document.id, accumulator.GetRelevance(document_index), document.rating });
+    }
+    return top_documents.Extract();
+}
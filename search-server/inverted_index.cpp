@@ -0,0 +1,99 @@
+#include "inverted_index.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+InvertedIndex::TermId InvertedIndex::AddTerm(std::string_view word) {
+    const auto it = word_to_term_.find(word);
+    if (it != word_to_term_.end()) {
+        return it->second;
+    }
+    const std::string_view stored_word = term_storage_.Store(word);
+    const TermId term_id = static_cast<TermId>(terms_.size());
+    word_to_term_.emplace(stored_word, term_id);
+    terms_.push_back(stored_word);
+    postings_.emplace_back();
+    max_term_freqs_.push_back(0.0);
+    log_document_freqs_.push_back(0.0);
+    return term_id;
+}
+
+InvertedIndex::TermId InvertedIndex::FindTerm(std::string_view word) const {
+    const auto it = word_to_term_.find(word);
+    if (it == word_to_term_.end()) {
+        return NO_TERM;
+    }
+    return it->second;
+}
+
+std::string_view InvertedIndex::GetTerm(TermId term_id) const {
+    return terms_.at(term_id);
+}
+
+size_t InvertedIndex::GetTermCount() const {
+    return terms_.size();
+}
+
+void InvertedIndex::AddPosting(TermId term_id, int document_index, uint32_t term_count, uint32_t document_length) {
+    auto& postings = postings_.at(term_id);
+    max_term_freqs_[term_id] = std::max(max_term_freqs_[term_id], ComputeTermFreq(term_count, document_length));
+    // Внутренние индексы документов растут, поэтому вставка обычно идёт в конец
+    postings.Insert(document_index, term_count, document_length);
+    UpdateLogDocumentFreq(term_id);
+}
+
+void InvertedIndex::RemovePosting(TermId term_id, int document_index) {
+    auto& postings = postings_.at(term_id);
+    const std::optional<double> term_freq = postings.Remove(document_index);
+    if (term_freq) {
+        if (*term_freq >= max_term_freqs_[term_id]) {
+            max_term_freqs_[term_id] = postings.GetMaxTermFreq();
+        }
+        UpdateLogDocumentFreq(term_id);
+    }
+}
+
+void InvertedIndex::RemapDocuments(const std::vector<int>& new_indexes) {
+    // Порядок документов не меняется, поэтому списки собираются заново дописыванием в конец,
+    // а частоты и число документов слов остаются прежними
+    for (auto& postings : postings_) {
+        PostingList remapped;
+        for (PostingCursor cursor(postings); !cursor.IsEnd(); cursor.Next()) {
+            remapped.Append(new_indexes[cursor.GetDocumentIndex()], cursor.GetTermCount(), cursor.GetDocumentLength());
+        }
+        postings = std::move(remapped);
+    }
+}
+
+const PostingList& InvertedIndex::GetPostings(TermId term_id) const {
+    return postings_.at(term_id);
+}
+
+double InvertedIndex::GetLogDocumentFreq(TermId term_id) const {
+    return log_document_freqs_.at(term_id);
+}
+
+void InvertedIndex::UpdateLogDocumentFreq(TermId term_id) {
+    const size_t document_freq = postings_[term_id].size();
+    log_document_freqs_[term_id] = document_freq == 0 ? 0.0 : std::log(static_cast<double>(document_freq));
+}
+
+double InvertedIndex::GetMaxTermFreq(TermId term_id) const {
+    return max_term_freqs_.at(term_id);
+}
+
+size_t InvertedIndex::GetPostingCount() const {
+    size_t count = 0;
+    for (const auto& postings : postings_) {
+        count += postings.size();
+    }
+    return count;
+}
+
+size_t InvertedIndex::GetPostingBytes() const {
+    size_t bytes = 0;
+    for (const auto& postings : postings_) {
+        bytes += postings.GetEncodedBytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "posting_list.h"
+#include "text_arena.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Инвертированный индекс: каждое слово получает числовой идентификатор,
+// а его документы хранятся в сжатом списке, отсортированном по document_index.
+class InvertedIndex {
+public:
+    using TermId = int;
+    static const TermId NO_TERM = -1;
+
+    // Новое слово копируется в хранилище индекса, каждое различное слово хранится один раз.
+    // Идентификатор и строка слова остаются действительными, даже когда у слова не осталось документов.
+    TermId AddTerm(std::string_view word);
+
+    TermId FindTerm(std::string_view word) const;
+
+    std::string_view GetTerm(TermId term_id) const;
+
+    size_t GetTermCount() const;
+
+    // Документ не должен уже присутствовать в списке этого слова
+    // Частота слова в документе — term_count / document_length, см. ComputeTermFreq
+    void AddPosting(TermId term_id, int document_index, uint32_t term_count, uint32_t document_length);
+
+    void RemovePosting(TermId term_id, int document_index);
+
+    // Переносит документы на новые индексы: документ old_index становится new_indexes[old_index].
+    // Новые индексы должны сохранять порядок документов, удалённым документам соответствует -1.
+    void RemapDocuments(const std::vector<int>& new_indexes);
+
+    const PostingList& GetPostings(TermId term_id) const;
+
+    // Логарифм числа документов со словом. Пересчитывается при изменении списка,
+    // поэтому при поиске idf слова получается одним вычитанием
+    double GetLogDocumentFreq(TermId term_id) const;
+
+    // Наибольшая частота слова среди его документов, верхняя оценка для отсечения при поиске
+    double GetMaxTermFreq(TermId term_id) const;
+
+    size_t GetPostingCount() const;
+
+    // Объём закодированных списков документов в байтах
+    size_t GetPostingBytes() const;
+
+private:
+    TextArena term_storage_;
+    std::unordered_map<std::string_view, TermId> word_to_term_;
+    std::vector<std::string_view> terms_;
+    std::vector<PostingList> postings_;
+    std::vector<double> max_term_freqs_;
+    std::vector<double> log_document_freqs_;
+
+    void UpdateLogDocumentFreq(TermId term_id);
+};
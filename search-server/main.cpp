@@ -1,5 +1,6 @@
 #include "process_queries.h"
 #include "search_server.h"
+#include "search_server_tests.h"
 #include <iostream>
 #include <string>
 #include <vector>
@@ -15,6 +16,7 @@ void PrintDocument(const Document& document) {
         << "rating = "s << document.rating << " }"s << endl;
 }
 int main() {
+    TestSearchServer();
     SearchServer search_server("and with"s);
     int id = 0;
     for (
@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 
 using namespace std::literals;
@@ -11,7 +13,12 @@ using namespace std::literals;
 template <typename Iterator>
 class IteratorRange {
 public:
-    IteratorRange(Iterator begin, Iterator end) :begin_(begin), end_(end) {} 
+    IteratorRange(Iterator begin, Iterator end)
+        : IteratorRange(begin, end, static_cast<size_t>(std::distance(begin, end)))
+    {
+    }
+
+    IteratorRange(Iterator begin, Iterator end, size_t size) :begin_(begin), end_(end), size_(size) {}
 
     Iterator begin() const {
         return begin_;
@@ -22,43 +29,98 @@ public:
     }
 
     size_t size() const {
-        size_ = std::distance(begin_, end_);
         return size_;
     }
 
+private:
     Iterator begin_;
     Iterator end_;
     size_t size_;
 };
 
+// Страницы не хранятся: каждая собирается при обращении к ней и только ссылается на элементы контейнера
 template <typename const_iterator>
 class Paginator {
 public:
+    class PageIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IteratorRange<const_iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        PageIterator(const_iterator begin, size_t remaining, size_t page_size)
+            : begin_(begin), remaining_(remaining), page_size_(page_size) {}
+
+        IteratorRange<const_iterator> operator*() const {
+            const size_t page_size = std::min(page_size_, remaining_);
+            return { begin_, std::next(begin_, page_size), page_size };
+        }
+
+        PageIterator& operator++() {
+            const size_t page_size = std::min(page_size_, remaining_);
+            std::advance(begin_, page_size);
+            remaining_ -= page_size;
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return remaining_ == other.remaining_;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const_iterator begin_;
+        size_t remaining_;
+        size_t page_size_;
+    };
+
     Paginator(const_iterator begin, const_iterator end, size_t size)
+        : begin_(begin), end_(end), item_count_(static_cast<size_t>(std::distance(begin, end))), page_size_(size)
     {
-        for (size_t i = distance(begin, end); i > 0; ) {
-            const size_t page_size = std::min(size, i);
-            const const_iterator step = std::next(begin, page_size);
-            DocsInPage.push_back({ begin, step });
-            i -= page_size;
-            begin = step;
+        if (page_size_ == 0) {
+            throw std::invalid_argument("Размер страницы должен быть больше нуля"s);
         }
     }
 
-    auto begin() const {
-        return DocsInPage.begin();
+    PageIterator begin() const {
+        return { begin_, item_count_, page_size_ };
     }
 
-    auto end() const {
-        return DocsInPage.end();
+    PageIterator end() const {
+        return { end_, 0, page_size_ };
     }
 
-    size_t size() {
-        return DocsInPage.size();
+    size_t size() const {
+        return (item_count_ + page_size_ - 1) / page_size_;
+    }
+
+    // Страница по номеру; для итераторов произвольного доступа без прохода по предыдущим страницам
+    IteratorRange<const_iterator> GetPage(size_t page_index) const {
+        if (page_index >= size()) {
+            throw std::out_of_range("Нет страницы с таким номером"s);
+        }
+        const size_t first = page_index * page_size_;
+        const size_t page_size = std::min(page_size_, item_count_ - first);
+        const const_iterator page_begin = std::next(begin_, first);
+        return { page_begin, std::next(page_begin, page_size), page_size };
     }
 
 private:
-    std::vector<IteratorRange<const_iterator>> DocsInPage;
+    const_iterator begin_;
+    const_iterator end_;
+    size_t item_count_;
+    size_t page_size_;
 };
 
 template <typename Iterator>
@@ -69,7 +131,8 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& q) {
     return out;
 }
 
-std::ostream& operator<<(std::ostream& cout, const Document& doc) {
+// inline, чтобы заголовок можно было подключать в нескольких единицах трансляции
+inline std::ostream& operator<<(std::ostream& cout, const Document& doc) {
     return cout << "{ "s << "document_id = "s
         << doc.id << ", "s
         << "relevance = "s
@@ -81,4 +144,4 @@ std::ostream& operator<<(std::ostream& cout, const Document& doc) {
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
-}
\ No newline at end of file
+}
@@ -0,0 +1,106 @@
+#include "position_index.h"
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+void PositionIndex::AddDocument(int document_index, const std::vector<InvertedIndex::TermId>& term_ids) {
+    if (documents_.size() <= static_cast<size_t>(document_index)) {
+        documents_.resize(document_index + 1);
+    }
+    // Вхождения упорядочиваются по слову, а внутри слова — по позиции
+    std::vector<std::pair<InvertedIndex::TermId, uint32_t>> occurrences(term_ids.size());
+    for (size_t position = 0; position < term_ids.size(); ++position) {
+        occurrences[position] = { term_ids[position], static_cast<uint32_t>(position) };
+    }
+    std::sort(occurrences.begin(), occurrences.end());
+
+    DocumentPositions& document = documents_[document_index];
+    document.terms.clear();
+    document.data.clear();
+    uint32_t previous_position = 0;
+    for (const auto& [term_id, position] : occurrences) {
+        if (document.terms.empty() || document.terms.back().term_id != term_id) {
+            document.terms.push_back({ term_id, static_cast<uint32_t>(document.data.size()), 0 });
+            previous_position = 0;
+        }
+        ++document.terms.back().count;
+        for (uint32_t delta = position - previous_position; ; delta >>= 7) {
+            if (delta < 0x80) {
+                document.data.push_back(static_cast<uint8_t>(delta));
+                break;
+            }
+            document.data.push_back(static_cast<uint8_t>(delta | 0x80));
+        }
+        previous_position = position;
+    }
+    document.terms.shrink_to_fit();
+    document.data.shrink_to_fit();
+}
+
+void PositionIndex::RemoveDocument(int document_index) {
+    if (static_cast<size_t>(document_index) < documents_.size()) {
+        documents_[document_index] = {};
+    }
+}
+
+void PositionIndex::RemapDocuments(const std::vector<int>& new_indexes) {
+    std::vector<DocumentPositions> documents;
+    for (size_t document_index = 0; document_index < documents_.size(); ++document_index) {
+        const int new_index = new_indexes[document_index];
+        if (new_index < 0) {
+            continue;
+        }
+        if (documents.size() <= static_cast<size_t>(new_index)) {
+            documents.resize(new_index + 1);
+        }
+        documents[new_index] = std::move(documents_[document_index]);
+    }
+    documents_ = std::move(documents);
+}
+
+bool PositionIndex::HasTerm(int document_index, InvertedIndex::TermId term_id) const {
+    return FindEntry(document_index, term_id) != nullptr;
+}
+
+bool PositionIndex::GetPositions(int document_index, InvertedIndex::TermId term_id, std::vector<uint32_t>& positions) const {
+    positions.clear();
+    const TermEntry* entry = FindEntry(document_index, term_id);
+    if (!entry) {
+        return false;
+    }
+    const uint8_t* input = documents_[document_index].data.data() + entry->offset;
+    uint32_t position = 0;
+    for (uint32_t i = 0; i < entry->count; ++i) {
+        uint32_t delta = 0;
+        for (int shift = 0; ; shift += 7) {
+            const uint8_t byte = *input++;
+            delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                break;
+            }
+        }
+        position += delta;
+        positions.push_back(position);
+    }
+    return true;
+}
+
+size_t PositionIndex::GetEncodedBytes() const {
+    size_t bytes = 0;
+    for (const DocumentPositions& document : documents_) {
+        bytes += document.terms.size() * sizeof(TermEntry) + document.data.size();
+    }
+    return bytes;
+}
+
+const PositionIndex::TermEntry* PositionIndex::FindEntry(int document_index, InvertedIndex::TermId term_id) const {
+    if (document_index < 0 || static_cast<size_t>(document_index) >= documents_.size()) {
+        return nullptr;
+    }
+    const std::vector<TermEntry>& terms = documents_[document_index].terms;
+    const auto it = std::lower_bound(terms.begin(), terms.end(), term_id, [](const TermEntry& entry, InvertedIndex::TermId id) {
+        return entry.term_id < id;
+    });
+    return it != terms.end() && it->term_id == term_id ? &*it : nullptr;
+}
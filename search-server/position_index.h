@@ -0,0 +1,46 @@
+#pragma once
+#include "inverted_index.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Позиции слов в документах для фразового поиска и близости слов.
+// Позиция — номер слова в документе без стоп-слов. Позиции слова в документе хранятся по возрастанию
+// разностями с предыдущей, каждая разность — varint (7 бит на байт), поэтому соседние слова занимают байт.
+// Позиции документа лежат вместе, а таблица его слов отсортирована по идентификатору слова:
+// есть ли слово в документе, проверяется без распаковки позиций.
+class PositionIndex {
+public:
+    // term_ids — слова документа по порядку, без стоп-слов
+    void AddDocument(int document_index, const std::vector<InvertedIndex::TermId>& term_ids);
+
+    void RemoveDocument(int document_index);
+
+    // Переносит позиции документов на новые индексы, см. InvertedIndex::RemapDocuments
+    void RemapDocuments(const std::vector<int>& new_indexes);
+
+    bool HasTerm(int document_index, InvertedIndex::TermId term_id) const;
+
+    // Записывает в positions позиции слова в документе по возрастанию. false, если слова в документе нет.
+    bool GetPositions(int document_index, InvertedIndex::TermId term_id, std::vector<uint32_t>& positions) const;
+
+    // Объём закодированных позиций и таблиц слов в байтах
+    size_t GetEncodedBytes() const;
+
+private:
+    struct TermEntry {
+        InvertedIndex::TermId term_id;
+        // Начало позиций слова в data документа
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    struct DocumentPositions {
+        std::vector<TermEntry> terms;
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<DocumentPositions> documents_;
+
+    const TermEntry* FindEntry(int document_index, InvertedIndex::TermId term_id) const;
+};
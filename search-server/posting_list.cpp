@@ -0,0 +1,321 @@
+#include "posting_list.h"
+#include <algorithm>
+#include <utility>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+namespace {
+
+// На каждый документ блока кодируются три числа: разность индексов, число вхождений слова и длина документа
+const size_t VALUES_PER_POSTING = 3;
+
+size_t GetEncodedLength(uint32_t value) {
+    return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+}
+
+#ifdef __SSSE3__
+// Для каждого управляющего байта — маска перестановки, раскладывающая 4 числа по 32-битным ячейкам,
+// и суммарная длина этих чисел
+struct ShuffleTables {
+    __m128i masks[256];
+    uint8_t lengths[256];
+
+    ShuffleTables() {
+        for (int code = 0; code < 256; ++code) {
+            alignas(16) uint8_t mask[16];
+            uint8_t source = 0;
+            for (int value = 0; value < 4; ++value) {
+                const int length = ((code >> (2 * value)) & 3) + 1;
+                for (int byte = 0; byte < 4; ++byte) {
+                    mask[4 * value + byte] = byte < length ? source++ : 0x80;
+                }
+            }
+            masks[code] = _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+            lengths[code] = source;
+        }
+    }
+};
+
+const ShuffleTables& GetShuffleTables() {
+    static const ShuffleTables tables;
+    return tables;
+}
+#endif
+
+void EncodeValues(const uint32_t* values, size_t count, std::vector<uint8_t>& output) {
+    const size_t control_offset = output.size();
+    output.resize(control_offset + (count + 3) / 4, 0);
+    for (size_t i = 0; i < count; ++i) {
+        const size_t length = GetEncodedLength(values[i]);
+        output[control_offset + i / 4] |= static_cast<uint8_t>((length - 1) << (2 * (i % 4)));
+        for (size_t byte = 0; byte < length; ++byte) {
+            output.push_back(static_cast<uint8_t>(values[i] >> (8 * byte)));
+        }
+    }
+}
+
+// Длина count закодированных чисел, считается по управляющим байтам
+size_t GetEncodedValuesSize(const uint8_t* input, size_t count) {
+    const size_t control_size = (count + 3) / 4;
+    size_t size = control_size + count;
+    for (size_t i = 0; i < control_size; ++i) {
+        // Длины неиспользуемых чисел последнего байта нулевые, поэтому его можно сложить целиком
+        const uint8_t control = input[i];
+        size += (control & 3) + (control >> 2 & 3) + (control >> 4 & 3) + (control >> 6);
+    }
+    return size;
+}
+
+void DecodeValues(const uint8_t* input, const uint8_t* input_end, size_t count, uint32_t* values) {
+    const uint8_t* control = input;
+    const uint8_t* data = input + (count + 3) / 4;
+    size_t i = 0;
+#ifdef __SSSE3__
+    // Четвёрка чисел занимает не больше 16 байт; пока столько есть до конца блока, она распаковывается одной перестановкой
+    const ShuffleTables& tables = GetShuffleTables();
+    for (; i + 4 <= count && input_end - data >= 16; i += 4) {
+        const uint8_t code = control[i / 4];
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_shuffle_epi8(packed, tables.masks[code]));
+        data += tables.lengths[code];
+    }
+#else
+    (void)input_end;
+#endif
+    for (; i < count; ++i) {
+        const size_t length = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+        uint32_t value = 0;
+        for (size_t byte = 0; byte < length; ++byte) {
+            value |= static_cast<uint32_t>(data[byte]) << (8 * byte);
+        }
+        values[i] = value;
+        data += length;
+    }
+}
+
+} // namespace
+
+void PostingList::Append(int document_index, uint32_t term_count, uint32_t document_length) {
+    tail_.push_back({ document_index, term_count, document_length });
+    ++size_;
+    if (tail_.size() == BLOCK_SIZE) {
+        blocks_.push_back({ tail_.front().document_index, tail_.back().document_index,
+            static_cast<uint32_t>(data_.size()), static_cast<uint32_t>(tail_.size()), ComputeMaxTermFreq(tail_.data(), tail_.size()) });
+        EncodeBlock(tail_.data(), tail_.size(), data_);
+        tail_.clear();
+    }
+}
+
+void PostingList::Insert(int document_index, uint32_t term_count, uint32_t document_length) {
+    if (size_ == 0 || (tail_.empty() ? blocks_.back().last_document_index : tail_.back().document_index) < document_index) {
+        Append(document_index, term_count, document_length);
+        return;
+    }
+    std::vector<RawPosting> postings(size_);
+    RawPosting* output = postings.data();
+    for (const Block& block : blocks_) {
+        DecodeBlock(data_.data() + block.offset, block, output);
+        output += block.count;
+    }
+    std::copy(tail_.begin(), tail_.end(), output);
+    const auto it = std::lower_bound(postings.begin(), postings.end(), document_index,
+        [](const RawPosting& posting, int index) { return posting.document_index < index; });
+    postings.insert(it, { document_index, term_count, document_length });
+
+    *this = PostingList();
+    for (const RawPosting& posting : postings) {
+        Append(posting.document_index, posting.term_count, posting.document_length);
+    }
+}
+
+std::optional<double> PostingList::Remove(int document_index) {
+    if (!tail_.empty() && tail_.front().document_index <= document_index) {
+        const auto it = std::lower_bound(tail_.begin(), tail_.end(), document_index,
+            [](const RawPosting& posting, int index) { return posting.document_index < index; });
+        if (it == tail_.end() || it->document_index != document_index) {
+            return std::nullopt;
+        }
+        const double term_freq = ComputeTermFreq(it->term_count, it->document_length);
+        tail_.erase(it);
+        --size_;
+        return term_freq;
+    }
+
+    const auto block_it = std::lower_bound(blocks_.begin(), blocks_.end(), document_index,
+        [](const Block& block, int index) { return block.last_document_index < index; });
+    if (block_it == blocks_.end() || block_it->first_document_index > document_index) {
+        return std::nullopt;
+    }
+    const size_t block = block_it - blocks_.begin();
+    const size_t block_bytes = GetBlockBytes(block);
+    RawPosting postings[BLOCK_SIZE];
+    DecodeBlock(data_.data() + block_it->offset, *block_it, postings);
+    RawPosting* const postings_end = postings + block_it->count;
+    RawPosting* const it = std::lower_bound(postings, postings_end, document_index,
+        [](const RawPosting& posting, int index) { return posting.document_index < index; });
+    if (it == postings_end || it->document_index != document_index) {
+        return std::nullopt;
+    }
+    const double term_freq = ComputeTermFreq(it->term_count, it->document_length);
+    std::copy(it + 1, postings_end, it);
+    const size_t count = block_it->count - 1;
+    --size_;
+
+    if (count == 0) {
+        blocks_.erase(block_it);
+        free_bytes_ += block_bytes;
+    }
+    else {
+        // Разность индексов вокруг удалённого документа занимает не больше байт, чем две прежние,
+        // поэтому блок помещается на старое место и следующие блоки не сдвигаются
+        std::vector<uint8_t> encoded;
+        EncodeBlock(postings, count, encoded);
+        std::copy(encoded.begin(), encoded.end(), data_.begin() + block_it->offset);
+        free_bytes_ += block_bytes - encoded.size();
+        block_it->first_document_index = postings[0].document_index;
+        block_it->last_document_index = postings[count - 1].document_index;
+        block_it->count = static_cast<uint32_t>(count);
+        block_it->max_term_freq = ComputeMaxTermFreq(postings, count);
+    }
+    if (free_bytes_ > data_.size() / 2) {
+        Compact();
+    }
+    return term_freq;
+}
+
+double PostingList::GetMaxTermFreq() const {
+    double max_term_freq = ComputeMaxTermFreq(tail_.data(), tail_.size());
+    for (const Block& block : blocks_) {
+        max_term_freq = std::max(max_term_freq, block.max_term_freq);
+    }
+    return max_term_freq;
+}
+
+size_t PostingList::size() const {
+    return size_;
+}
+
+bool PostingList::empty() const {
+    return size_ == 0;
+}
+
+size_t PostingList::GetEncodedBytes() const {
+    return data_.size() - free_bytes_ + blocks_.size() * sizeof(Block) + tail_.size() * sizeof(RawPosting);
+}
+
+size_t PostingList::GetBlockBytes(size_t block) const {
+    return GetEncodedValuesSize(data_.data() + blocks_[block].offset, VALUES_PER_POSTING * blocks_[block].count);
+}
+
+void PostingList::Compact() {
+    std::vector<uint8_t> data;
+    data.reserve(data_.size() - free_bytes_);
+    for (size_t block = 0; block < blocks_.size(); ++block) {
+        const auto block_begin = data_.begin() + blocks_[block].offset;
+        const size_t block_bytes = GetBlockBytes(block);
+        blocks_[block].offset = static_cast<uint32_t>(data.size());
+        data.insert(data.end(), block_begin, block_begin + block_bytes);
+    }
+    data_ = std::move(data);
+    free_bytes_ = 0;
+}
+
+double PostingList::ComputeMaxTermFreq(const RawPosting* postings, size_t count) {
+    double max_term_freq = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        max_term_freq = std::max(max_term_freq, ComputeTermFreq(postings[i].term_count, postings[i].document_length));
+    }
+    return max_term_freq;
+}
+
+void PostingList::EncodeBlock(const RawPosting* postings, size_t count, std::vector<uint8_t>& output) {
+    uint32_t values[VALUES_PER_POSTING * BLOCK_SIZE];
+    int previous_index = postings[0].document_index;
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = static_cast<uint32_t>(postings[i].document_index - previous_index);
+        values[count + i] = postings[i].term_count;
+        values[2 * count + i] = postings[i].document_length;
+        previous_index = postings[i].document_index;
+    }
+    EncodeValues(values, VALUES_PER_POSTING * count, output);
+}
+
+void PostingList::DecodeBlock(const uint8_t* input, const Block& block, RawPosting* postings) const {
+    const size_t count = block.count;
+    uint32_t values[VALUES_PER_POSTING * BLOCK_SIZE];
+    DecodeValues(input, data_.data() + data_.size(), VALUES_PER_POSTING * count, values);
+    int document_index = block.first_document_index;
+    for (size_t i = 0; i < count; ++i) {
+        document_index += static_cast<int>(values[i]);
+        postings[i] = { document_index, values[count + i], values[2 * count + i] };
+    }
+}
+
+PostingCursor::PostingCursor(const PostingList& postings)
+    : postings_(&postings)
+{
+    LoadBlock(0);
+}
+
+bool PostingCursor::IsEnd() const {
+    return position_ == count_;
+}
+
+int PostingCursor::GetDocumentIndex() const {
+    return GetBlockData()[position_].document_index;
+}
+
+double PostingCursor::GetTermFreq() const {
+    const PostingList::RawPosting& posting = GetBlockData()[position_];
+    return ComputeTermFreq(posting.term_count, posting.document_length);
+}
+
+uint32_t PostingCursor::GetTermCount() const {
+    return GetBlockData()[position_].term_count;
+}
+
+uint32_t PostingCursor::GetDocumentLength() const {
+    return GetBlockData()[position_].document_length;
+}
+
+void PostingCursor::Next() {
+    ++position_;
+    if (position_ == count_ && block_ < postings_->blocks_.size()) {
+        LoadBlock(block_ + 1);
+    }
+}
+
+void PostingCursor::SkipTo(int document_index) {
+    if (IsEnd() || GetDocumentIndex() >= document_index) {
+        return;
+    }
+    // По границам блоков пропускаются все блоки, целиком лежащие левее искомого документа
+    const auto& blocks = postings_->blocks_;
+    if (block_ < blocks.size() && blocks[block_].last_document_index < document_index) {
+        const auto it = std::lower_bound(blocks.begin() + block_ + 1, blocks.end(), document_index,
+            [](const PostingList::Block& block, int index) { return block.last_document_index < index; });
+        LoadBlock(it - blocks.begin());
+    }
+    const PostingList::RawPosting* data = GetBlockData();
+    position_ = std::lower_bound(data + position_, data + count_, document_index,
+        [](const PostingList::RawPosting& posting, int index) { return posting.document_index < index; }) - data;
+}
+
+const PostingList::RawPosting* PostingCursor::GetBlockData() const {
+    return block_ < postings_->blocks_.size() ? decoded_ : postings_->tail_.data();
+}
+
+void PostingCursor::LoadBlock(size_t block) {
+    const auto& blocks = postings_->blocks_;
+    block_ = block;
+    position_ = 0;
+    if (block < blocks.size()) {
+        postings_->DecodeBlock(postings_->data_.data() + blocks[block].offset, blocks[block], decoded_);
+        count_ = blocks[block].count;
+    }
+    else {
+        count_ = postings_->tail_.size();
+    }
+}
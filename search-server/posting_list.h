@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// document_index — внутренний индекс документа в SearchServer, а не его id
+struct Posting {
+    int document_index;
+    double term_freq;
+};
+
+// Частота слова хранится без потерь как пара небольших целых: сколько раз слово
+// встретилось в документе и сколько в документе слов без стоп-слов
+inline double ComputeTermFreq(uint32_t term_count, uint32_t document_length) {
+    return static_cast<double>(term_count) / document_length;
+}
+
+// Сжатый список документов слова, отсортированный по document_index.
+// Документы собираются в блоки по BLOCK_SIZE: индексы хранятся разностями с предыдущим,
+// все числа блока кодируются в формате StreamVByte (2 бита длины на число + 1-4 байта значения).
+// Для каждого блока помнятся первый и последний индексы, по ним курсор пропускает блоки целиком.
+// Последние документы, ещё не набравшие блок, лежат несжатыми.
+// При удалении блок перекодируется на своём месте: новая запись не длиннее старой, а освободившиеся
+// байты остаются дырой до следующего сжатия, которое случается, когда дыры занимают больше половины данных.
+class PostingList {
+public:
+    static const size_t BLOCK_SIZE = 128;
+
+    // Индекс документа должен быть больше всех индексов в списке
+    void Append(int document_index, uint32_t term_count, uint32_t document_length);
+
+    // Вставка в произвольное место, список пересобирается целиком
+    void Insert(int document_index, uint32_t term_count, uint32_t document_length);
+
+    // Возвращает частоту удалённого документа, если он был в списке
+    std::optional<double> Remove(int document_index);
+
+    // Наибольшая частота слова в списке; считается по максимумам блоков, блоки не распаковываются
+    double GetMaxTermFreq() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    // Байт на хранение самих документов, без учёта запаса в векторах
+    size_t GetEncodedBytes() const;
+
+private:
+    friend class PostingCursor;
+
+    struct Block {
+        int first_document_index;
+        int last_document_index;
+        uint32_t offset;
+        uint32_t count;
+        double max_term_freq;
+    };
+
+    struct RawPosting {
+        int document_index;
+        uint32_t term_count;
+        uint32_t document_length;
+    };
+
+    std::vector<Block> blocks_;
+    std::vector<uint8_t> data_;
+    std::vector<RawPosting> tail_;
+    size_t size_ = 0;
+    // Байт в дырах, оставшихся в data_ после удалений
+    size_t free_bytes_ = 0;
+
+    // Длина закодированных данных блока без дыры за ним
+    size_t GetBlockBytes(size_t block) const;
+
+    // Сдвигает блоки вплотную друг к другу, не перекодируя их
+    void Compact();
+
+    static double ComputeMaxTermFreq(const RawPosting* postings, size_t count);
+
+    static void EncodeBlock(const RawPosting* postings, size_t count, std::vector<uint8_t>& output);
+
+    void DecodeBlock(const uint8_t* input, const Block& block, RawPosting* postings) const;
+};
+
+// Последовательный проход по списку документов слова с пропуском вперёд.
+// Блок распаковывается целиком при входе в него.
+class PostingCursor {
+public:
+    explicit PostingCursor(const PostingList& postings);
+
+    // Курсор, пропускающий не распаковывая блоки, для которых has_documents(first, last) ложно:
+    // в диапазоне индексов блока заведомо нет нужных документов. Несжатый хвост не пропускается.
+    template <typename BlockFilter>
+    PostingCursor(const PostingList& postings, const BlockFilter& has_documents);
+
+    bool IsEnd() const;
+
+    int GetDocumentIndex() const;
+
+    double GetTermFreq() const;
+
+    // Слагаемые частоты, см. ComputeTermFreq
+    uint32_t GetTermCount() const;
+
+    uint32_t GetDocumentLength() const;
+
+    void Next();
+
+    // Next, пропускающий блоки так же, как конструктор с фильтром блоков
+    template <typename BlockFilter>
+    void Next(const BlockFilter& has_documents);
+
+    // Переходит к первому документу с индексом не меньше document_index
+    void SkipTo(int document_index);
+
+private:
+    const PostingList* postings_;
+    // Номер текущего блока, blocks_.size() означает несжатый хвост
+    size_t block_ = 0;
+    size_t position_ = 0;
+    size_t count_ = 0;
+    PostingList::RawPosting decoded_[PostingList::BLOCK_SIZE];
+
+    // Распакованный текущий блок или сам хвост списка
+    const PostingList::RawPosting* GetBlockData() const;
+
+    void LoadBlock(size_t block);
+
+    // Загружает первый блок, начиная с block, который проходит фильтр
+    template <typename BlockFilter>
+    void LoadBlock(size_t block, const BlockFilter& has_documents);
+};
+
+template <typename BlockFilter>
+PostingCursor::PostingCursor(const PostingList& postings, const BlockFilter& has_documents)
+    : postings_(&postings)
+{
+    LoadBlock(0, has_documents);
+}
+
+template <typename BlockFilter>
+void PostingCursor::Next(const BlockFilter& has_documents) {
+    ++position_;
+    if (position_ == count_ && block_ < postings_->blocks_.size()) {
+        LoadBlock(block_ + 1, has_documents);
+    }
+}
+
+template <typename BlockFilter>
+void PostingCursor::LoadBlock(size_t block, const BlockFilter& has_documents) {
+    const auto& blocks = postings_->blocks_;
+    while (block < blocks.size() && !has_documents(blocks[block].first_document_index, blocks[block].last_document_index)) {
+        ++block;
+    }
+    LoadBlock(block);
+}
@@ -0,0 +1,83 @@
+#include "process_queries.h"
+#include <algorithm>
+#include <execution>
+#include <numeric>
+
+std::vector<std::vector<Document>> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+    std::vector<std::vector<Document>> documents_lists(queries.size());
+    // Запросы раздаются потокам пула по мере освобождения, поэтому длинные запросы не задерживают остальные
+    std::transform(std::execution::par, queries.begin(), queries.end(), documents_lists.begin(),
+        [&search_server](const std::string& query) { return search_server.FindTopDocuments(query); });
+    return documents_lists;
+}
+
+JoinedDocuments::Iterator::Iterator(std::vector<std::vector<Document>>::const_iterator query_it,
+    std::vector<std::vector<Document>>::const_iterator query_end)
+    : query_it_(query_it)
+    , query_end_(query_end)
+{
+    SkipEmptyQueries();
+}
+
+JoinedDocuments::Iterator::reference JoinedDocuments::Iterator::operator*() const {
+    return (*query_it_)[document_index_];
+}
+
+JoinedDocuments::Iterator::pointer JoinedDocuments::Iterator::operator->() const {
+    return &**this;
+}
+
+JoinedDocuments::Iterator& JoinedDocuments::Iterator::operator++() {
+    if (++document_index_ == query_it_->size()) {
+        ++query_it_;
+        document_index_ = 0;
+        SkipEmptyQueries();
+    }
+    return *this;
+}
+
+JoinedDocuments::Iterator JoinedDocuments::Iterator::operator++(int) {
+    Iterator old = *this;
+    ++*this;
+    return old;
+}
+
+bool JoinedDocuments::Iterator::operator==(const Iterator& other) const {
+    return query_it_ == other.query_it_ && document_index_ == other.document_index_;
+}
+
+bool JoinedDocuments::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+void JoinedDocuments::Iterator::SkipEmptyQueries() {
+    while (query_it_ != query_end_ && query_it_->empty()) {
+        ++query_it_;
+    }
+}
+
+JoinedDocuments::JoinedDocuments(std::vector<std::vector<Document>> documents)
+    : documents_(std::move(documents))
+{
+}
+
+JoinedDocuments::Iterator JoinedDocuments::begin() const {
+    return { documents_.begin(), documents_.end() };
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end() const {
+    return { documents_.end(), documents_.end() };
+}
+
+size_t JoinedDocuments::size() const {
+    return std::transform_reduce(documents_.begin(), documents_.end(), size_t{ 0 }, std::plus<>(),
+        [](const std::vector<Document>& documents) { return documents.size(); });
+}
+
+JoinedDocuments ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+    return JoinedDocuments(ProcessQueries(search_server, queries));
+}
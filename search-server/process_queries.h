@@ -0,0 +1,62 @@
+#pragma once
+#include "search_server.h"
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Выполняет запросы параллельно, результаты идут в порядке запросов
+std::vector<std::vector<Document>> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+// Результаты всех запросов подряд. Документы не копируются в общий вектор,
+// итератор проходит по результатам запросов по очереди.
+class JoinedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator(std::vector<std::vector<Document>>::const_iterator query_it,
+            std::vector<std::vector<Document>>::const_iterator query_end);
+
+        reference operator*() const;
+
+        pointer operator->() const;
+
+        Iterator& operator++();
+
+        Iterator operator++(int);
+
+        bool operator==(const Iterator& other) const;
+
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        void SkipEmptyQueries();
+
+        std::vector<std::vector<Document>>::const_iterator query_it_;
+        std::vector<std::vector<Document>>::const_iterator query_end_;
+        size_t document_index_ = 0;
+    };
+
+    explicit JoinedDocuments(std::vector<std::vector<Document>> documents);
+
+    Iterator begin() const;
+
+    Iterator end() const;
+
+    size_t size() const;
+
+private:
+    std::vector<std::vector<Document>> documents_;
+};
+
+JoinedDocuments ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
@@ -0,0 +1,89 @@
+#include "query_cache.h"
+#include <algorithm>
+#include <functional>
+
+bool operator==(const QueryCacheKey& lhs, const QueryCacheKey& rhs) {
+    return lhs.status == rhs.status && lhs.top_count == rhs.top_count && lhs.query == rhs.query;
+}
+
+size_t QueryCacheKeyHasher::operator()(const QueryCacheKey& key) const {
+    size_t hash = std::hash<std::string>{}(key.query);
+    hash = hash * 31 + static_cast<size_t>(key.status);
+    return hash * 31 + key.top_count;
+}
+
+double QueryCacheStats::GetHitRate() const {
+    const uint64_t requests = hits + misses;
+    return requests == 0 ? 0.0 : static_cast<double>(hits) / requests;
+}
+
+QueryCache::QueryCache(size_t capacity, size_t shard_count)
+    : shard_capacity_(std::max<size_t>(1, (capacity + shard_count - 1) / std::max<size_t>(1, shard_count)))
+    , shards_(std::max<size_t>(1, shard_count))
+{
+}
+
+std::optional<std::vector<Document>> QueryCache::Find(const QueryCacheKey& key, uint64_t generation) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto it = shard.positions.find(key);
+    if (it == shard.positions.end()) {
+        ++misses_;
+        return std::nullopt;
+    }
+    if (it->second->generation != generation) {
+        shard.entries.erase(it->second);
+        shard.positions.erase(it);
+        ++misses_;
+        ++invalidations_;
+        return std::nullopt;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    ++hits_;
+    return it->second->documents;
+}
+
+void QueryCache::Insert(const QueryCacheKey& key, uint64_t generation, const std::vector<Document>& documents) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto it = shard.positions.find(key);
+    if (it != shard.positions.end()) {
+        // Выдачу более старой версии не записываем поверх более новой
+        if (it->second->generation <= generation) {
+            it->second->generation = generation;
+            it->second->documents = documents;
+        }
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+    shard.entries.push_front({ key, generation, documents });
+    shard.positions.emplace(key, shard.entries.begin());
+    if (shard.entries.size() > shard_capacity_) {
+        shard.positions.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+        ++evictions_;
+    }
+}
+
+void QueryCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        shard.positions.clear();
+        shard.entries.clear();
+    }
+}
+
+QueryCacheStats QueryCache::GetStats() const {
+    QueryCacheStats stats;
+    stats.hits = hits_.load();
+    stats.misses = misses_.load();
+    stats.invalidations = invalidations_.load();
+    stats.evictions = evictions_.load();
+    return stats;
+}
+
+QueryCache::Shard& QueryCache::GetShard(const QueryCacheKey& key) {
+    // Старшие биты хеша перемешиваются с младшими, чтобы выбор сегмента не совпадал с выбором корзины внутри него
+    const size_t hash = QueryCacheKeyHasher{}(key);
+    return shards_[(hash ^ (hash >> 29)) % shards_.size()];
+}
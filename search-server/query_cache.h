@@ -0,0 +1,78 @@
+#pragma once
+#include "document.h"
+#include "search_server.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Запрос в кэше: канонический вид запроса (SearchServer::NormalizeQuery), статус документов и размер выдачи
+struct QueryCacheKey {
+    std::string query;
+    DocumentStatus status;
+    size_t top_count;
+};
+
+bool operator==(const QueryCacheKey& lhs, const QueryCacheKey& rhs);
+
+struct QueryCacheKeyHasher {
+    size_t operator()(const QueryCacheKey& key) const;
+};
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Промахи из-за того, что запись была получена при другой версии сервера
+    uint64_t invalidations = 0;
+    uint64_t evictions = 0;
+
+    double GetHitRate() const;
+};
+
+// Потокобезопасный кэш выдачи. Записи разложены по независимым сегментам со своей блокировкой
+// и своей очередью LRU, сегмент выбирается по хешу ключа.
+// Каждая запись помнит версию сервера (SearchServer::GetGeneration), при которой получена выдача,
+// и считается устаревшей, как только версия изменилась.
+class QueryCache {
+public:
+    static const size_t DEFAULT_CAPACITY = 4096;
+    static const size_t DEFAULT_SHARD_COUNT = 16;
+
+    explicit QueryCache(size_t capacity = DEFAULT_CAPACITY, size_t shard_count = DEFAULT_SHARD_COUNT);
+
+    std::optional<std::vector<Document>> Find(const QueryCacheKey& key, uint64_t generation);
+
+    void Insert(const QueryCacheKey& key, uint64_t generation, const std::vector<Document>& documents);
+
+    void Clear();
+
+    QueryCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        QueryCacheKey key;
+        uint64_t generation;
+        std::vector<Document> documents;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        // В начале — недавно использованные записи
+        std::list<Entry> entries;
+        std::unordered_map<QueryCacheKey, std::list<Entry>::iterator, QueryCacheKeyHasher> positions;
+    };
+
+    size_t shard_capacity_;
+    std::vector<Shard> shards_;
+    std::atomic<uint64_t> hits_ = 0;
+    std::atomic<uint64_t> misses_ = 0;
+    std::atomic<uint64_t> invalidations_ = 0;
+    std::atomic<uint64_t> evictions_ = 0;
+
+    Shard& GetShard(const QueryCacheKey& key);
+};
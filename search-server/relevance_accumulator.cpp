@@ -0,0 +1,39 @@
+#include "relevance_accumulator.h"
+#include <algorithm>
+
+using namespace std;
+
+RelevanceAccumulator::RelevanceAccumulator(size_t slot_count, size_t max_slot_count) {
+    static thread_local Buffers thread_buffers;
+    if (thread_buffers.is_busy) {
+        own_buffers_ = std::make_unique<Buffers>();
+        buffers_ = own_buffers_.get();
+    }
+    else {
+        buffers_ = &thread_buffers;
+    }
+    buffers_->is_busy = true;
+    // Все ячейки сброшены, поэтому массивы можно урезать без очистки
+    const size_t shrunk_slot_count = std::max(max_slot_count, MIN_SHRUNK_SLOT_COUNT);
+    if (buffers_->states.size() > 4 * shrunk_slot_count) {
+        buffers_->states.resize(shrunk_slot_count);
+        buffers_->states.shrink_to_fit();
+        buffers_->relevances.resize(shrunk_slot_count);
+        buffers_->relevances.shrink_to_fit();
+        buffers_->touched_slots.shrink_to_fit();
+    }
+    // Новые ячейки уже сброшены
+    if (buffers_->states.size() < slot_count) {
+        buffers_->states.resize(slot_count, State::UNSEEN);
+        buffers_->relevances.resize(slot_count, 0.0);
+    }
+}
+
+RelevanceAccumulator::~RelevanceAccumulator() {
+    for (const size_t slot : buffers_->touched_slots) {
+        buffers_->states[slot] = State::UNSEEN;
+        buffers_->relevances[slot] = 0.0;
+    }
+    buffers_->touched_slots.clear();
+    buffers_->is_busy = false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Релевантности документов одного запроса в плоских массивах: ячейка на внутренний индекс документа
+// (или на его сдвиг от начала диапазона). Массивы принадлежат потоку и переживают запрос,
+// а при освобождении сбрасываются только затронутые ячейки, поэтому запрос не выделяет
+// и не обнуляет память размером с коллекцию.
+class RelevanceAccumulator {
+public:
+    enum class State : char { UNSEEN, MATCHED, EXCLUDED };
+
+    // Занимает массивы потока не меньше чем на slot_count ячеек, все ячейки UNSEEN.
+    // Если массивы потока уже заняты, берутся отдельные. max_slot_count — сколько ячеек может понадобиться
+    // потоку вообще (обычно число внутренних индексов сервера): массивы, которые больше него в несколько раз,
+    // например после сжатия индексов, урезаются.
+    RelevanceAccumulator(size_t slot_count, size_t max_slot_count);
+
+    RelevanceAccumulator(const RelevanceAccumulator&) = delete;
+    RelevanceAccumulator& operator=(const RelevanceAccumulator&) = delete;
+
+    ~RelevanceAccumulator();
+
+    State GetState(size_t slot) const {
+        return buffers_->states[slot];
+    }
+
+    double GetRelevance(size_t slot) const {
+        return buffers_->relevances[slot];
+    }
+
+    void Match(size_t slot) {
+        Touch(slot);
+        buffers_->states[slot] = State::MATCHED;
+    }
+
+    void Exclude(size_t slot) {
+        Touch(slot);
+        buffers_->states[slot] = State::EXCLUDED;
+    }
+
+    void Add(size_t slot, double relevance) {
+        buffers_->relevances[slot] += relevance;
+    }
+
+    // Затронутые ячейки в порядке первого касания
+    const std::vector<size_t>& GetTouchedSlots() const {
+        return buffers_->touched_slots;
+    }
+
+private:
+    struct Buffers {
+        std::vector<State> states;
+        std::vector<double> relevances;
+        std::vector<size_t> touched_slots;
+        bool is_busy = false;
+    };
+
+    // Массивы меньше этого не урезаются, чтобы поиск по серверам разного размера в одном потоке
+    // не выделял их каждый раз заново
+    static constexpr size_t MIN_SHRUNK_SLOT_COUNT = 1 << 16;
+
+    Buffers* buffers_;
+    std::unique_ptr<Buffers> own_buffers_;
+
+    void Touch(size_t slot) {
+        if (buffers_->states[slot] == State::UNSEEN) {
+            buffers_->touched_slots.push_back(slot);
+        }
+    }
+};
@@ -1,24 +1,191 @@
 #include "remove_duplicates.h"
+#include <cstdint>
+#include <limits>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+
+// Финальное перемешивание splitmix64: биекция, каждый бит результата зависит от всех битов аргумента
+uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// 128-битный отпечаток набора слов. Случайное совпадение отпечатков у разных наборов
+// маловероятнее ошибки памяти, поэтому наборы по совпавшим отпечаткам не сравниваются.
+struct Fingerprint {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const Fingerprint& other) const {
+        return low == other.low && high == other.high;
+    }
+};
+
+struct FingerprintHasher {
+    size_t operator()(const Fingerprint& fingerprint) const {
+        return static_cast<size_t>(fingerprint.low);
+    }
+};
+
+// Идентификаторы отсортированы, поэтому отпечаток не зависит от порядка слов в документе
+Fingerprint ComputeFingerprint(const std::vector<InvertedIndex::TermId>& term_ids) {
+    Fingerprint fingerprint{ 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL ^ term_ids.size() };
+    for (const InvertedIndex::TermId term_id : term_ids) {
+        const uint64_t value = static_cast<uint32_t>(term_id);
+        fingerprint.low = Mix(fingerprint.low ^ value);
+        fingerprint.high = Mix(fingerprint.high + value * 0xFF51AFD7ED558CCDULL);
+    }
+    return fingerprint;
+}
+
+std::vector<int> GetDocumentIds(const SearchServer& search_server) {
+    return { search_server.begin(), search_server.end() };
+}
+
+void CheckOptions(const NearDuplicateOptions& options) {
+    if (!(options.jaccard_threshold > 0.0 && options.jaccard_threshold <= 1.0)) {
+        throw std::invalid_argument("Порог сходства должен быть в пределах (0, 1]"s);
+    }
+    if (options.band_count == 0 || options.rows_per_band == 0) {
+        throw std::invalid_argument("Число полос и строк в полосе должно быть положительным"s);
+    }
+}
+
+// Ключи полос MinHash-подписи. Значение i-й хеш-функции для слова — Mix(слово ^ seeds[i]),
+// минимум по словам документа одинаков у двух документов с вероятностью, равной мере Жаккара.
+// Полоса превращается в один ключ, чтобы совпадение полосы проверялось одним поиском в таблице.
+void ComputeBandKeys(const std::vector<InvertedIndex::TermId>& term_ids, const std::vector<uint64_t>& seeds,
+    const NearDuplicateOptions& options, uint64_t* band_keys) {
+    std::vector<uint64_t> signature(seeds.size(), std::numeric_limits<uint64_t>::max());
+    for (const InvertedIndex::TermId term_id : term_ids) {
+        const uint64_t value = static_cast<uint32_t>(term_id);
+        for (size_t i = 0; i < seeds.size(); ++i) {
+            signature[i] = std::min(signature[i], Mix(value ^ seeds[i]));
+        }
+    }
+    for (size_t band = 0; band < options.band_count; ++band) {
+        uint64_t key = band;
+        for (size_t row = 0; row < options.rows_per_band; ++row) {
+            key = Mix(key ^ signature[band * options.rows_per_band + row]);
+        }
+        band_keys[band] = key;
+    }
+}
+
+// Точная проверка кандидата по отсортированным наборам слов
+bool IsNearDuplicate(const std::vector<InvertedIndex::TermId>& lhs, const std::vector<InvertedIndex::TermId>& rhs, double jaccard_threshold) {
+    size_t intersection_size = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (*lhs_it < *rhs_it) {
+            ++lhs_it;
+        }
+        else if (*rhs_it < *lhs_it) {
+            ++rhs_it;
+        }
+        else {
+            ++intersection_size;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    const size_t union_size = lhs.size() + rhs.size() - intersection_size;
+    if (union_size == 0) {
+        return true;
+    }
+    return static_cast<double>(intersection_size) >= jaccard_threshold * static_cast<double>(union_size) - COMPARISON_ACCURACY;
+}
+
+void RemoveDocuments(SearchServer& search_server, const std::vector<int>& document_ids) {
+    for (const int document_id : document_ids) {
+        std::cout << "Found duplicate document "s << document_id << std::endl;
+        search_server.RemoveDocument(document_id);
+    }
+}
+
+} // namespace
+
+std::vector<int> FindDuplicates(const SearchServer& search_server) {
+    const std::vector<int> document_ids = GetDocumentIds(search_server);
+    std::vector<Fingerprint> fingerprints(document_ids.size());
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), fingerprints.begin(), [&search_server](int document_id) {
+        return ComputeFingerprint(search_server.GetDocumentTerms(document_id));
+    });
+
+    std::vector<int> duplicates;
+    std::unordered_set<Fingerprint, FingerprintHasher> seen_fingerprints;
+    seen_fingerprints.reserve(document_ids.size());
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        if (!seen_fingerprints.insert(fingerprints[i]).second) {
+            duplicates.push_back(document_ids[i]);
+        }
+    }
+    return duplicates;
+}
+
+std::vector<int> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options) {
+    CheckOptions(options);
+    const std::vector<int> document_ids = GetDocumentIds(search_server);
+    const size_t document_count = document_ids.size();
+
+    std::vector<uint64_t> seeds(options.band_count * options.rows_per_band);
+    for (size_t i = 0; i < seeds.size(); ++i) {
+        seeds[i] = Mix(options.seed + i * 0x9E3779B97F4A7C15ULL);
+    }
+    std::vector<std::vector<InvertedIndex::TermId>> document_terms(document_count);
+    std::vector<uint64_t> band_keys(document_count * options.band_count);
+    std::vector<size_t> positions(document_count);
+    std::iota(positions.begin(), positions.end(), 0);
+    std::for_each(std::execution::par, positions.begin(), positions.end(), [&](size_t position) {
+        document_terms[position] = search_server.GetDocumentTerms(document_ids[position]);
+        ComputeBandKeys(document_terms[position], seeds, options, &band_keys[position * options.band_count]);
+    });
+
+    // Документы просматриваются по возрастанию id, в корзины полос попадают только оставляемые,
+    // поэтому каждый удаляемый документ похож на оставленный, а не на другой удалённый
+    std::vector<int> duplicates;
+    std::vector<std::unordered_map<uint64_t, std::vector<size_t>>> band_buckets(options.band_count);
+    std::vector<size_t> last_checked(document_count, document_count);
+    for (size_t position = 0; position < document_count; ++position) {
+        const uint64_t* keys = &band_keys[position * options.band_count];
+        bool is_duplicate = false;
+        for (size_t band = 0; band < options.band_count && !is_duplicate; ++band) {
+            const auto it = band_buckets[band].find(keys[band]);
+            if (it == band_buckets[band].end()) {
+                continue;
+            }
+            for (const size_t candidate : it->second) {
+                // Кандидат мог совпасть с документом и в предыдущих полосах
+                if (last_checked[candidate] == position) {
+                    continue;
+                }
+                last_checked[candidate] = position;
+                if (IsNearDuplicate(document_terms[position], document_terms[candidate], options.jaccard_threshold)) {
+                    is_duplicate = true;
+                    break;
+                }
+            }
+        }
+        if (is_duplicate) {
+            duplicates.push_back(document_ids[position]);
+            continue;
+        }
+        for (size_t band = 0; band < options.band_count; ++band) {
+            band_buckets[band][keys[band]].push_back(position);
+        }
+    }
+    return duplicates;
+}
 
 void RemoveDuplicates(SearchServer& search_server) {
-	SearchServer& inside = search_server;
-	std::set<std::set<std::string>> no_dupl_words;
-	std::vector<int> del_id;
-	for (const auto document_id : inside) {
-		std::set<std::string> doc_words;
-		for (auto [word, _] : search_server.GetWordFrequencies(document_id)){
-			doc_words.insert(word);
-		}
-		if (no_dupl_words.count(doc_words)) {
-			del_id.push_back(document_id);
-		}
-		else {
-			no_dupl_words.insert(doc_words);
-		}
-		doc_words.clear();
-	}
-	for (const auto id : del_id) {
-		std::cout << "Found duplicate document "s << id << std::endl;
-		search_server.RemoveDocument(id);
-	}
+    RemoveDocuments(search_server, FindDuplicates(search_server));
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options) {
+    RemoveDocuments(search_server, FindNearDuplicates(search_server, options));
 }
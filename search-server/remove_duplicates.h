@@ -2,4 +2,24 @@
 
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+// Параметры поиска почти-дубликатов: документы считаются дубликатами, если мера Жаккара
+// их наборов слов не меньше jaccard_threshold. Кандидаты отбираются по MinHash-подписям
+// из band_count полос по rows_per_band значений: пара становится кандидатом, если совпала
+// хотя бы одна полоса, и затем проверяется точно. Больше строк в полосе — меньше
+// кандидатов с низким сходством, больше полос — меньше пропусков при высоком.
+struct NearDuplicateOptions {
+    double jaccard_threshold = 0.8;
+    size_t band_count = 20;
+    size_t rows_per_band = 5;
+    uint64_t seed = 1;
+};
+
+// Документы с тем же набором слов, что и у документа с меньшим id, по возрастанию id
+std::vector<int> FindDuplicates(const SearchServer& search_server);
+
+// Документы, похожие на оставляемый документ с меньшим id, по возрастанию id
+std::vector<int> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options = {});
+
+void RemoveDuplicates(SearchServer& search_server);
+
+void RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options = {});
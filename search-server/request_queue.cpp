@@ -1,39 +1,47 @@
 #include "request_queue.h"
 
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
+RequestQueue::RequestQueue(const SearchServer& search_server, size_t cache_capacity, std::chrono::minutes statistics_window)
     : double_server(search_server)
+    , cache_(cache_capacity)
+    , statistics_(statistics_window)
 {
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    std::vector<Document> query = double_server.FindTopDocuments(raw_query, status);
-    AddResult(query);
-    return query;
+    const auto start_time = RequestStatistics::Clock::now();
+    const QueryCacheKey key{ double_server.NormalizeQuery(raw_query), status, MAX_RESULT_DOCUMENT_COUNT };
+    const uint64_t generation = double_server.GetGeneration();
+    std::optional<std::vector<Document>> cached = cache_.Find(key, generation);
+    if (!cached) {
+        cached = double_server.FindTopDocuments(raw_query, status);
+        cache_.Insert(key, generation, *cached);
+    }
+    AddResult(*cached, start_time);
+    return std::move(*cached);
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
-    std::vector<Document> query = double_server.FindTopDocuments(raw_query);
-    AddResult(query);
-    return query;
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return zero_;
+    return static_cast<int>(statistics_.GetStats().no_result_requests);
 }
 
-void RequestQueue::AddResult(const std::vector<Document>& query) {
-    QueryResult result;
-    if (query.size() == 0) {
-        ++zero_;
-    }
-    result.query_result_ = static_cast<int>(query.size());
-    requests_.push_back(result);
-    ++result_request;
-    if (result_request > min_in_day_) {
-        if (requests_[0].query_result_ == 0) {
-            --zero_;
-        }
-        requests_.pop_front();
-    }
-}
\ No newline at end of file
+RequestStats RequestQueue::GetStats() const {
+    return statistics_.GetStats();
+}
+
+RequestStats RequestQueue::GetStats(std::chrono::minutes window) const {
+    return statistics_.GetStats(window);
+}
+
+QueryCacheStats RequestQueue::GetCacheStats() const {
+    return cache_.GetStats();
+}
+
+void RequestQueue::AddResult(const std::vector<Document>& query, RequestStatistics::Clock::time_point start_time) {
+    const auto now = RequestStatistics::Clock::now();
+    statistics_.Record(query.size(), now - start_time, now);
+}
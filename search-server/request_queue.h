@@ -1,39 +1,48 @@
 #pragma once
 #include "search_server.h"
-#include <deque>
+#include "query_cache.h"
+#include "request_statistics.h"
+#include <chrono>
 #include <vector>
 
+// Запросы к одному серверу с кэшем выдачи и статистикой за скользящее окно.
+// Методы можно вызывать из нескольких потоков одновременно, пока сервер не изменяют.
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    explicit RequestQueue(const SearchServer& search_server, size_t cache_capacity = QueryCache::DEFAULT_CAPACITY,
+        std::chrono::minutes statistics_window = RequestStatistics::DEFAULT_WINDOW);
     // сделаем "обёртки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
+    // Выдача по предикату не кэшируется: у произвольного предиката нет ключа для сравнения
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
 
+    // Выдача по статусу берётся из кэша, пока сервер не изменился
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
 
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
+    // Запросы без результатов за всё окно статистики
     int GetNoResultRequests() const;
 
+    RequestStats GetStats() const;
+
+    RequestStats GetStats(std::chrono::minutes window) const;
+
+    QueryCacheStats GetCacheStats() const;
+
 private:
-    void AddResult(const std::vector<Document>& query);
-
-    struct QueryResult {
-    public:
-        int query_result_;
-    };
-    std::deque<QueryResult> requests_;
-    const static int min_in_day_ = 1440;
-    int result_request = 0;
     const SearchServer& double_server;
-    int zero_ = 0;
+    QueryCache cache_;
+    RequestStatistics statistics_;
+
+    void AddResult(const std::vector<Document>& query, RequestStatistics::Clock::time_point start_time);
 };
 
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    const auto start_time = RequestStatistics::Clock::now();
     std::vector<Document> query = double_server.FindTopDocuments(raw_query, document_predicate);
-    AddResult(query);
+    AddResult(query, start_time);
     return query;
-}
\ No newline at end of file
+}
@@ -0,0 +1,143 @@
+#include "request_statistics.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// Наименьшее значение, которое не меньше доли quantile всех записей
+template <typename Counts, typename GetMaxValue>
+uint64_t GetQuantile(const Counts& counts, uint64_t total, double quantile, GetMaxValue get_max_value) {
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * total + 0.5));
+    uint64_t seen = 0;
+    for (size_t index = 0; index < counts.size(); ++index) {
+        seen += counts[index];
+        if (seen >= rank) {
+            return get_max_value(index);
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+double RequestStats::GetNoResultRate() const {
+    return requests == 0 ? 0.0 : static_cast<double>(no_result_requests) / requests;
+}
+
+RequestStatistics::RequestStatistics(std::chrono::minutes window)
+    : bucket_count_(window.count() > 0 ? static_cast<size_t>(window.count()) : 0)
+{
+    if (bucket_count_ == 0) {
+        throw std::invalid_argument("Окно статистики должно быть не меньше минуты"s);
+    }
+    buckets_ = std::make_unique<MinuteBucket[]>(bucket_count_);
+    for (size_t i = 0; i < bucket_count_; ++i) {
+        MinuteBucket& bucket = buckets_[i];
+        for (auto& count : bucket.result_counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        for (auto& count : bucket.latency_counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        bucket.max_latency_ns.store(0, std::memory_order_relaxed);
+    }
+}
+
+void RequestStatistics::Record(size_t result_count, std::chrono::nanoseconds latency, Clock::time_point now) {
+    const uint64_t minute = GetMinute(now);
+    MinuteBucket& bucket = buckets_[minute % bucket_count_];
+    // Задержка обрезается так же, как в корзинах задержек, чтобы поместиться рядом с минутой
+    const uint64_t latency_ns = std::min(static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)), COUNTER_VALUE_MASK);
+    const auto increment = [](uint64_t count) { return std::min(count + 1, COUNTER_VALUE_MASK); };
+    UpdateCounter(bucket.result_counts[std::min(result_count, bucket.result_counts.size() - 1)], minute, increment);
+    UpdateCounter(bucket.latency_counts[GetLatencyBucketIndex(latency_ns)], minute, increment);
+    UpdateCounter(bucket.max_latency_ns, minute, [latency_ns](uint64_t max_latency_ns) { return std::max(max_latency_ns, latency_ns); });
+}
+
+RequestStats RequestStatistics::GetStats(std::chrono::minutes window, Clock::time_point now) const {
+    RequestStats stats;
+    const uint64_t last_minute = GetMinute(now);
+    const uint64_t minute_count = static_cast<uint64_t>(std::max<int64_t>(std::min<int64_t>(window.count(), bucket_count_), 0));
+    std::array<uint64_t, LATENCY_BUCKET_COUNT> latency_counts{};
+    for (uint64_t minute = last_minute + 1 > minute_count ? last_minute + 1 - minute_count : 0; minute <= last_minute; ++minute) {
+        const MinuteBucket& bucket = buckets_[minute % bucket_count_];
+        for (size_t i = 0; i < stats.result_counts.size(); ++i) {
+            stats.result_counts[i] += LoadCounter(bucket.result_counts[i], minute);
+        }
+        for (size_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+            latency_counts[i] += LoadCounter(bucket.latency_counts[i], minute);
+        }
+        stats.latency.max_ns = std::max(stats.latency.max_ns, LoadCounter(bucket.max_latency_ns, minute));
+    }
+    for (const uint64_t count : stats.result_counts) {
+        stats.requests += count;
+    }
+    stats.no_result_requests = stats.result_counts[0];
+    for (const uint64_t count : latency_counts) {
+        stats.latency.count += count;
+    }
+    stats.latency.p50_ns = GetQuantile(latency_counts, stats.latency.count, 0.5, GetLatencyBucketMaxValue);
+    stats.latency.p99_ns = GetQuantile(latency_counts, stats.latency.count, 0.99, GetLatencyBucketMaxValue);
+    stats.latency.p999_ns = GetQuantile(latency_counts, stats.latency.count, 0.999, GetLatencyBucketMaxValue);
+    // Верхняя граница корзины может оказаться больше настоящего максимума
+    stats.latency.p50_ns = std::min(stats.latency.p50_ns, stats.latency.max_ns);
+    stats.latency.p99_ns = std::min(stats.latency.p99_ns, stats.latency.max_ns);
+    stats.latency.p999_ns = std::min(stats.latency.p999_ns, stats.latency.max_ns);
+    return stats;
+}
+
+RequestStats RequestStatistics::GetStats() const {
+    return GetStats(GetWindow());
+}
+
+std::chrono::minutes RequestStatistics::GetWindow() const {
+    return std::chrono::minutes(bucket_count_);
+}
+
+uint64_t RequestStatistics::GetMinute(Clock::time_point time) {
+    return static_cast<uint64_t>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::minutes>(time.time_since_epoch()).count(), 0));
+}
+
+size_t RequestStatistics::GetLatencyBucketIndex(uint64_t value) {
+    const uint64_t max_value = (uint64_t(1) << LATENCY_MAX_VALUE_BITS) - 1;
+    value = std::min(value, max_value);
+    const size_t bit_width = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    const size_t magnitude = bit_width > LATENCY_SUB_BUCKET_BITS ? bit_width - LATENCY_SUB_BUCKET_BITS : 0;
+    return magnitude * LATENCY_SUB_BUCKET_HALF + static_cast<size_t>(value >> magnitude);
+}
+
+uint64_t RequestStatistics::GetLatencyBucketMaxValue(size_t index) {
+    if (index < 2 * LATENCY_SUB_BUCKET_HALF) {
+        return index;
+    }
+    const size_t magnitude = index / LATENCY_SUB_BUCKET_HALF - 1;
+    const uint64_t sub_bucket = index - magnitude * LATENCY_SUB_BUCKET_HALF;
+    return ((sub_bucket + 1) << magnitude) - 1;
+}
+
+template <typename Update>
+void RequestStatistics::UpdateCounter(std::atomic<uint64_t>& counter, uint64_t minute, Update update) {
+    uint64_t packed = counter.load(std::memory_order_relaxed);
+    while (true) {
+        const uint64_t counter_minute = packed >> COUNTER_VALUE_BITS;
+        // Запрос из прошлого, который поток досчитал уже после смены минуты, в новую минуту не попадает
+        if (counter_minute > minute) {
+            return;
+        }
+        const uint64_t value = counter_minute == minute ? packed & COUNTER_VALUE_MASK : 0;
+        const uint64_t new_value = update(value);
+        if (counter_minute == minute && new_value == value) {
+            return;
+        }
+        if (counter.compare_exchange_weak(packed, minute << COUNTER_VALUE_BITS | new_value, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+uint64_t RequestStatistics::LoadCounter(const std::atomic<uint64_t>& counter, uint64_t minute) {
+    const uint64_t packed = counter.load(std::memory_order_relaxed);
+    return packed >> COUNTER_VALUE_BITS == minute ? packed & COUNTER_VALUE_MASK : 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "search_metrics.h"
+#include "search_server.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct RequestStats {
+    uint64_t requests = 0;
+    uint64_t no_result_requests = 0;
+    // result_counts[k] — число запросов с k документами в выдаче, в последнем элементе и все более длинные выдачи
+    std::array<uint64_t, MAX_RESULT_DOCUMENT_COUNT + 1> result_counts{};
+    LatencyPercentiles latency;
+
+    double GetNoResultRate() const;
+};
+
+// Статистика запросов за скользящее окно. Окно — кольцо корзин по минуте.
+// Каждый счётчик корзины хранит вместе со значением номер своей минуты и обнуляется сам,
+// когда в него впервые пишут в новой минуте. Record вызывается из любого числа потоков без блокировок:
+// на запрос приходится пара CAS в корзине текущей минуты.
+class RequestStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::minutes DEFAULT_WINDOW{ 1440 };
+
+    explicit RequestStatistics(std::chrono::minutes window = DEFAULT_WINDOW);
+
+    void Record(size_t result_count, std::chrono::nanoseconds latency, Clock::time_point now = Clock::now());
+
+    // Статистика за последние window минут, включая текущую; окно больше заданного в конструкторе обрезается
+    RequestStats GetStats(std::chrono::minutes window, Clock::time_point now = Clock::now()) const;
+
+    RequestStats GetStats() const;
+
+    std::chrono::minutes GetWindow() const;
+
+private:
+    // Задержки с точностью до четверти порядка: до 8 нс точно, дальше 4 корзины на каждый диапазон [2^k, 2^(k+1))
+    static const size_t LATENCY_SUB_BUCKET_BITS = 3;
+    static const size_t LATENCY_SUB_BUCKET_HALF = size_t(1) << (LATENCY_SUB_BUCKET_BITS - 1);
+    // Задержки от 2^36 нс (около 69 секунд) попадают в последнюю корзину
+    static const size_t LATENCY_MAX_VALUE_BITS = 36;
+    static const size_t LATENCY_BUCKET_COUNT
+        = (LATENCY_MAX_VALUE_BITS - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKET_HALF + LATENCY_SUB_BUCKET_HALF;
+
+    // Счётчик — одно 64-битное слово: в старших битах минута, к которой относится значение, в младших само значение.
+    // Минута и значение меняются одним CAS, поэтому запрос, досчитанный после смены минуты,
+    // не попадёт в счётчик новой минуты и не потеряется при её обнулении.
+    // Минуты считаются от запуска steady_clock, 28 бит хватает на сотни лет.
+    static constexpr size_t COUNTER_VALUE_BITS = LATENCY_MAX_VALUE_BITS;
+    static constexpr uint64_t COUNTER_VALUE_MASK = (uint64_t(1) << COUNTER_VALUE_BITS) - 1;
+
+    struct MinuteBucket {
+        std::array<std::atomic<uint64_t>, MAX_RESULT_DOCUMENT_COUNT + 1> result_counts;
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKET_COUNT> latency_counts;
+        std::atomic<uint64_t> max_latency_ns;
+    };
+
+    size_t bucket_count_;
+    std::unique_ptr<MinuteBucket[]> buckets_;
+
+    static uint64_t GetMinute(Clock::time_point time);
+
+    static size_t GetLatencyBucketIndex(uint64_t value);
+
+    static uint64_t GetLatencyBucketMaxValue(size_t index);
+
+    // Заменяет значение счётчика на update(значение за минуту minute); значение прошлой минуты считается нулём,
+    // а счётчик, уже перешедший на более позднюю минуту, не меняется
+    template <typename Update>
+    static void UpdateCounter(std::atomic<uint64_t>& counter, uint64_t minute, Update update);
+
+    // Значение счётчика за минуту minute
+    static uint64_t LoadCounter(const std::atomic<uint64_t>& counter, uint64_t minute);
+};
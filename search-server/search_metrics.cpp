@@ -0,0 +1,154 @@
+#include "search_metrics.h"
+#include <algorithm>
+
+using namespace std;
+
+const LatencyPercentiles& MetricsSnapshot::GetPhase(SearchPhase phase) const {
+    return phases[static_cast<size_t>(phase)];
+}
+
+uint64_t MetricsSnapshot::GetCounter(SearchCounter counter) const {
+    return counters[static_cast<size_t>(counter)];
+}
+
+std::ostream& operator<<(std::ostream& output, const MetricsSnapshot& snapshot) {
+    if (!snapshot.enabled) {
+        return output << "metrics disabled"s;
+    }
+    const char* phase_names[SEARCH_PHASE_COUNT] = { "parse", "posting_traversal", "minus_filter", "top_k" };
+    for (size_t phase = 0; phase < SEARCH_PHASE_COUNT; ++phase) {
+        const LatencyPercentiles& latency = snapshot.phases[phase];
+        output << phase_names[phase] << ": count="s << latency.count
+            << " p50="s << latency.p50_ns << "ns p99="s << latency.p99_ns
+            << "ns p999="s << latency.p999_ns << "ns max="s << latency.max_ns << "ns\n"s;
+    }
+    output << "queries="s << snapshot.GetCounter(SearchCounter::QUERIES)
+        << " postings_scanned="s << snapshot.GetCounter(SearchCounter::POSTINGS_SCANNED)
+        << " documents_scored="s << snapshot.GetCounter(SearchCounter::DOCUMENTS_SCORED);
+    return output;
+}
+
+#ifdef SEARCH_SERVER_METRICS
+
+namespace {
+
+// Наименьшее значение, которое не меньше доли quantile всех записей
+uint64_t GetQuantile(const std::array<uint64_t, LatencyHistogram::BUCKET_COUNT>& counts, uint64_t total, double quantile) {
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * total + 0.5));
+    uint64_t seen = 0;
+    for (size_t index = 0; index < counts.size(); ++index) {
+        seen += counts[index];
+        if (seen >= rank) {
+            return LatencyHistogram::GetBucketMaxValue(index);
+        }
+    }
+    return 0;
+}
+
+uint64_t GetNextMetricsId() {
+    static std::atomic<uint64_t> next_id = 0;
+    return ++next_id;
+}
+
+} // namespace
+
+void LatencyHistogram::Record(uint64_t value) {
+    std::atomic<uint64_t>& count = counts_[GetBucketIndex(value)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::AddTo(std::array<uint64_t, BUCKET_COUNT>& counts) const {
+    for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+        counts[index] += counts_[index].load(std::memory_order_relaxed);
+    }
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    const uint64_t max_value = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+    value = std::min(value, max_value);
+    const size_t bit_width = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    const size_t magnitude = bit_width > SUB_BUCKET_BITS ? bit_width - SUB_BUCKET_BITS : 0;
+    return magnitude * SUB_BUCKET_HALF + static_cast<size_t>(value >> magnitude);
+}
+
+uint64_t LatencyHistogram::GetBucketMaxValue(size_t index) {
+    if (index < 2 * SUB_BUCKET_HALF) {
+        return index;
+    }
+    const size_t magnitude = index / SUB_BUCKET_HALF - 1;
+    const uint64_t sub_bucket = index - magnitude * SUB_BUCKET_HALF;
+    return ((sub_bucket + 1) << magnitude) - 1;
+}
+
+SearchMetrics::SearchMetrics()
+    : id_(GetNextMetricsId())
+{
+}
+
+void SearchMetrics::Record(SearchPhase phase, uint64_t nanoseconds) {
+    GetThreadMetrics().histograms[static_cast<size_t>(phase)].Record(nanoseconds);
+}
+
+void SearchMetrics::Add(SearchCounter counter, uint64_t value) {
+    std::atomic<uint64_t>& total = GetThreadMetrics().counters[static_cast<size_t>(counter)];
+    total.store(total.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+MetricsSnapshot SearchMetrics::GetSnapshot() const {
+    MetricsSnapshot snapshot;
+    snapshot.enabled = true;
+    std::lock_guard guard(mutex_);
+    for (size_t phase = 0; phase < SEARCH_PHASE_COUNT; ++phase) {
+        std::array<uint64_t, LatencyHistogram::BUCKET_COUNT> counts{};
+        for (const auto& [_, thread_metrics] : threads_) {
+            thread_metrics->histograms[phase].AddTo(counts);
+        }
+        LatencyPercentiles& latency = snapshot.phases[phase];
+        for (size_t index = 0; index < counts.size(); ++index) {
+            latency.count += counts[index];
+            if (counts[index] > 0) {
+                latency.max_ns = LatencyHistogram::GetBucketMaxValue(index);
+            }
+        }
+        latency.p50_ns = GetQuantile(counts, latency.count, 0.5);
+        latency.p99_ns = GetQuantile(counts, latency.count, 0.99);
+        latency.p999_ns = GetQuantile(counts, latency.count, 0.999);
+    }
+    for (const auto& [_, thread_metrics] : threads_) {
+        for (size_t counter = 0; counter < SEARCH_COUNTER_COUNT; ++counter) {
+            snapshot.counters[counter] += thread_metrics->counters[counter].load(std::memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+
+SearchMetrics::ThreadMetrics& SearchMetrics::GetThreadMetrics() {
+    // Поток обычно пишет в метрики одного сервера, поэтому хватает кэша на один объект
+    thread_local uint64_t cached_id = 0;
+    thread_local ThreadMetrics* cached_metrics = nullptr;
+    if (cached_id == id_) {
+        return *cached_metrics;
+    }
+    std::lock_guard guard(mutex_);
+    auto& thread_metrics = threads_[std::this_thread::get_id()];
+    if (!thread_metrics) {
+        thread_metrics = std::make_unique<ThreadMetrics>();
+    }
+    cached_id = id_;
+    cached_metrics = thread_metrics.get();
+    return *thread_metrics;
+}
+
+PhaseTimer::PhaseTimer(SearchMetrics& metrics, SearchPhase phase)
+    : metrics_(metrics)
+    , phase_(phase)
+    , start_time_(std::chrono::steady_clock::now())
+{
+}
+
+PhaseTimer::~PhaseTimer() {
+    const auto duration = std::chrono::steady_clock::now() - start_time_;
+    metrics_.Record(phase_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+}
+
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#ifdef SEARCH_SERVER_METRICS
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#endif
+
+// Этапы поиска. Сложение tf * idf идёт в том же цикле, что и обход списков документов,
+// поэтому оценка документов входит в POSTING_TRAVERSAL, а её объём виден по счётчику DOCUMENTS_SCORED.
+enum class SearchPhase {
+    PARSE,
+    POSTING_TRAVERSAL,
+    MINUS_FILTER,
+    TOP_K,
+};
+
+inline constexpr size_t SEARCH_PHASE_COUNT = 4;
+
+enum class SearchCounter {
+    QUERIES,
+    POSTINGS_SCANNED,
+    DOCUMENTS_SCORED,
+};
+
+inline constexpr size_t SEARCH_COUNTER_COUNT = 3;
+
+struct LatencyPercentiles {
+    uint64_t count = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+struct MetricsSnapshot {
+    // false, если сервер собран без SEARCH_SERVER_METRICS
+    bool enabled = false;
+    std::array<LatencyPercentiles, SEARCH_PHASE_COUNT> phases{};
+    std::array<uint64_t, SEARCH_COUNTER_COUNT> counters{};
+
+    const LatencyPercentiles& GetPhase(SearchPhase phase) const;
+
+    uint64_t GetCounter(SearchCounter counter) const;
+};
+
+std::ostream& operator<<(std::ostream& output, const MetricsSnapshot& snapshot);
+
+#ifdef SEARCH_SERVER_METRICS
+
+// Гистограмма задержек в наносекундах с относительной погрешностью меньше 1% (как HDR Histogram):
+// значения до 128 хранятся точно, дальше каждый диапазон [2^k, 2^(k+1)) делится на 64 равные корзины.
+// Пишет в гистограмму только один поток, поэтому запись — обычные load и store без атомарных сложений.
+class LatencyHistogram {
+public:
+    static const size_t SUB_BUCKET_BITS = 7;
+    static const size_t SUB_BUCKET_HALF = size_t(1) << (SUB_BUCKET_BITS - 1);
+    // Значения от 2^40 нс (около 18 минут) попадают в последнюю корзину
+    static const size_t MAX_VALUE_BITS = 40;
+    static const size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+
+    void Record(uint64_t value);
+
+    // Прибавляет счётчики корзин к counts
+    void AddTo(std::array<uint64_t, BUCKET_COUNT>& counts) const;
+
+    static size_t GetBucketIndex(uint64_t value);
+
+    // Наибольшее значение, попадающее в корзину
+    static uint64_t GetBucketMaxValue(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_{};
+};
+
+// Метрики сервера. Каждый поток пишет в свой набор гистограмм и счётчиков без блокировок;
+// блокировка берётся только при первой записи потока и при снятии снимка.
+class SearchMetrics {
+public:
+    SearchMetrics();
+
+    void Record(SearchPhase phase, uint64_t nanoseconds);
+
+    void Add(SearchCounter counter, uint64_t value);
+
+    MetricsSnapshot GetSnapshot() const;
+
+private:
+    struct ThreadMetrics {
+        std::array<LatencyHistogram, SEARCH_PHASE_COUNT> histograms;
+        std::array<std::atomic<uint64_t>, SEARCH_COUNTER_COUNT> counters{};
+    };
+
+    // Номер, а не адрес, отличает объект метрик в кэше потока: адрес может достаться новому объекту
+    const uint64_t id_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadMetrics>> threads_;
+
+    ThreadMetrics& GetThreadMetrics();
+};
+
+// Записывает время от создания до разрушения в гистограмму этапа
+class PhaseTimer {
+public:
+    PhaseTimer(SearchMetrics& metrics, SearchPhase phase);
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    ~PhaseTimer();
+
+private:
+    SearchMetrics& metrics_;
+    SearchPhase phase_;
+    std::chrono::steady_clock::time_point start_time_;
+};
+
+#define SEARCH_METRICS_CONCAT_INTERNAL(X, Y) X##Y
+#define SEARCH_METRICS_CONCAT(X, Y) SEARCH_METRICS_CONCAT_INTERNAL(X, Y)
+#define SEARCH_METRICS_PHASE(metrics, phase) PhaseTimer SEARCH_METRICS_CONCAT(phaseTimer, __LINE__)((metrics), (phase))
+#define SEARCH_METRICS_ADD(metrics, counter, value) (metrics).Add((counter), (value))
+
+#else
+
+// Без SEARCH_SERVER_METRICS замеры не компилируются вовсе, аргументы макросов не вычисляются
+#define SEARCH_METRICS_PHASE(metrics, phase) static_cast<void>(0)
+#define SEARCH_METRICS_ADD(metrics, counter, value) static_cast<void>(0)
+
+#endif
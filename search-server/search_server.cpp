@@ -3,8 +3,48 @@
 
 using namespace std;
 
+const std::vector<std::string_view>& ParsedQuery::GetPlusWords() const {
+    return plus_words_;
+}
+
+const std::vector<std::string_view>& ParsedQuery::GetMinusWords() const {
+    return minus_words_;
+}
+
+const std::vector<std::vector<std::string_view>>& ParsedQuery::GetPhrases() const {
+    return phrases_;
+}
+
+const std::vector<std::string_view>& ParsedQuery::GetPatterns() const {
+    return patterns_;
+}
+
+size_t DocumentMatches::size() const {
+    return document_ids_.size();
+}
+
+int DocumentMatches::GetDocumentId(size_t index) const {
+    return document_ids_[index];
+}
+
+DocumentStatus DocumentMatches::GetStatus(size_t index) const {
+    return statuses_[index];
+}
+
+DocumentMatches::Words DocumentMatches::GetWords(size_t index) const {
+    return { words_.data() + offsets_[index], words_.data() + offsets_[index + 1] };
+}
+
+SearchServer::SearchServer(StopWordSet stop_words)
+    : stop_words_(std::move(stop_words))
+{
+    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+        throw std::invalid_argument("Some of stop words are invalid"s);
+    }
+}
+
 SearchServer::SearchServer(const std::string& stop_words_text)
-    : SearchServer(SplitIntoWords(stop_words_text))
+    : SearchServer(std::string_view(stop_words_text))
 {
 }
 
@@ -14,44 +54,194 @@ SearchServer::SearchServer(std::string_view stop_words_text)
 }
 
 void SearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
-    if (document_id < 0 || documents_.count(document_id) > 0) {
+    if (document_id < 0 || document_indexes_.count(document_id) > 0) {
         throw std::invalid_argument("Попытка добавить невалидный документ"s);
     }
-    if (!IsValidWord(document)) {
-        throw std::invalid_argument("Попытка добавить документ c недопустимыми символами"s);
-    }
+    std::vector<std::pair<std::string_view, uint32_t>> stop_word_counts;
+    const std::vector<std::string_view> words = SplitIntoWordsNoStop(document, &stop_word_counts);
 
-    documents_storage.emplace_back(document);
-    const std::vector<std::string_view> words = SplitIntoWordsNoStop(documents_storage.back());
-    const double inv_word_count = 1.0 / words.size();
+    const int document_index = static_cast<int>(documents_.size());
+    const std::string_view text = document_texts_.Store(document);
+    const uint32_t word_count = static_cast<uint32_t>(words.size());
+    std::map<InvertedIndex::TermId, uint32_t> term_counts;
+    std::vector<InvertedIndex::TermId> term_sequence;
     for (const std::string_view& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        id_word_freqs_[document_id][word] += inv_word_count;
+        const InvertedIndex::TermId term_id = index_.AddTerm(word);
+        ++term_counts[term_id];
+        if (positions_) {
+            term_sequence.push_back(term_id);
+        }
+    }
+    auto& word_freqs = id_word_freqs_[document_id];
+    for (const auto [term_id, term_count] : term_counts) {
+        word_freqs.emplace(index_.GetTerm(term_id), ComputeTermFreq(term_count, word_count));
+        index_.AddPosting(term_id, document_index, term_count, word_count);
     }
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
+    if (positions_) {
+        positions_->AddDocument(document_index, term_sequence);
+    }
+    documents_.push_back({ document_id, ComputeAverageRating(ratings), status, text });
+    document_indexes_.emplace(document_id, document_index);
+    UpdateFilterBitmaps(document_index, true);
+    AddStopWordPostings(document_index, stop_word_counts, word_count);
     docs_id_.insert(document_id);
+    ++generation_;
 }
 
+std::vector<AddDocumentError> SearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    std::vector<AddDocumentError> errors;
+    std::vector<std::string> error_messages(documents.size());
+
+    // Документы с заведомо неверным id не разбираются. Повторы id внутри пакета
+    // выясняются при слиянии: добавится первый из них, который разобран без ошибок.
+    std::vector<size_t> accepted;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const int document_id = documents[i].id;
+        if (document_id < 0 || document_indexes_.count(document_id) > 0) {
+            error_messages[i] = "Попытка добавить невалидный документ"s;
+        }
+        else {
+            accepted.push_back(i);
+        }
+    }
+
+    // Частичный индекс части пакета: слово -> (номер в accepted, число вхождений)
+    struct PartialIndex {
+        std::unordered_map<std::string_view, std::vector<std::pair<size_t, uint32_t>>> word_postings;
+    };
+    std::vector<std::vector<std::pair<std::string_view, uint32_t>>> word_counts(accepted.size());
+    std::vector<std::vector<std::pair<std::string_view, uint32_t>>> stop_word_counts(accepted.size());
+    std::vector<uint32_t> document_lengths(accepted.size());
+    // Слова документов по порядку нужны только индексу позиций
+    std::vector<std::vector<std::string_view>> document_words(positions_ ? accepted.size() : 0);
+    const size_t part_count = std::max(1u, std::thread::hardware_concurrency());
+    const size_t part_size = (accepted.size() + part_count - 1) / part_count;
+    std::vector<PartialIndex> parts(part_count);
+    std::vector<size_t> part_indexes(part_count);
+    std::iota(part_indexes.begin(), part_indexes.end(), 0);
+    std::for_each(std::execution::par, part_indexes.begin(), part_indexes.end(), [&](size_t part) {
+        const size_t first = std::min(part * part_size, accepted.size());
+        const size_t last = std::min(first + part_size, accepted.size());
+        std::map<std::string_view, uint32_t> document_counts;
+        for (size_t i = first; i < last; ++i) {
+            std::vector<std::string_view> words;
+            try {
+                words = SplitIntoWordsNoStop(documents[accepted[i]].text, &stop_word_counts[i]);
+            }
+            catch (const std::invalid_argument& e) {
+                error_messages[accepted[i]] = e.what();
+                continue;
+            }
+            document_lengths[i] = static_cast<uint32_t>(words.size());
+            document_counts.clear();
+            for (const std::string_view word : words) {
+                ++document_counts[word];
+            }
+            word_counts[i].assign(document_counts.begin(), document_counts.end());
+            for (const auto [word, term_count] : document_counts) {
+                parts[part].word_postings[word].push_back({ i, term_count });
+            }
+            if (positions_) {
+                document_words[i] = std::move(words);
+            }
+        }
+    });
+
+    std::vector<int> document_indexes(accepted.size(), -1);
+    for (size_t i = 0; i < accepted.size(); ++i) {
+        const DocumentInput& document = documents[accepted[i]];
+        if (document_indexes_.count(document.id) > 0) {
+            error_messages[accepted[i]] = "Попытка добавить невалидный документ"s;
+            continue;
+        }
+        if (!error_messages[accepted[i]].empty()) {
+            continue;
+        }
+        const int document_index = static_cast<int>(documents_.size());
+        document_indexes[i] = document_index;
+        auto& document_word_freqs = id_word_freqs_[document.id];
+        for (const auto& [word, term_count] : word_counts[i]) {
+            document_word_freqs.emplace_hint(document_word_freqs.end(), index_.GetTerm(index_.AddTerm(word)),
+                ComputeTermFreq(term_count, document_lengths[i]));
+        }
+        if (positions_) {
+            std::vector<InvertedIndex::TermId> term_sequence;
+            term_sequence.reserve(document_words[i].size());
+            for (const std::string_view word : document_words[i]) {
+                term_sequence.push_back(index_.FindTerm(word));
+            }
+            positions_->AddDocument(document_index, term_sequence);
+        }
+        documents_.push_back({ document.id, ComputeAverageRating(document.ratings), document.status, document_texts_.Store(document.text) });
+        document_indexes_.emplace(document.id, document_index);
+        UpdateFilterBitmaps(document_index, true);
+        AddStopWordPostings(document_index, stop_word_counts[i], document_lengths[i]);
+        docs_id_.insert(document.id);
+    }
+
+    // Части идут в порядке пакета, а внутренние индексы выдаются по нему же,
+    // поэтому списки документов пополняются только с конца
+    for (const PartialIndex& part : parts) {
+        for (const auto& [word, postings] : part.word_postings) {
+            const InvertedIndex::TermId term_id = index_.AddTerm(word);
+            for (const auto& [position, term_count] : postings) {
+                if (document_indexes[position] >= 0) {
+                    index_.AddPosting(term_id, document_indexes[position], term_count, document_lengths[position]);
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < documents.size(); ++i) {
+        if (!error_messages[i].empty()) {
+            errors.push_back({ documents[i].id, std::move(error_messages[i]) });
+        }
+    }
+    if (errors.size() < documents.size()) {
+        ++generation_;
+    }
+    return errors;
+}
 
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return document_indexes_.size();
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
-    if (documents_.count(document_id) == 0) {
-        throw std::out_of_range("No document with id "s + std::to_string(document_id));
+uint64_t SearchServer::GetGeneration() const {
+    return generation_;
+}
+
+std::string SearchServer::NormalizeQuery(std::string_view raw_query) const {
+    // Слова не содержат управляющих символов, поэтому пробел однозначно их разделяет
+    const Query query = ParseQueryWords(raw_query);
+    std::string normalized_query;
+    for (const std::string_view word : query.plus_words) {
+        normalized_query.append(word).push_back(' ');
     }
-    bool need_sort = true;
-    const static Query query = ParseQuery(raw_query, need_sort);
-    if (std::any_of(query.minus_words.begin(), query.minus_words.end(), [this, document_id](auto& minus_word) {return id_word_freqs_.at(document_id).count(minus_word); })) {
-        return { {},  documents_.at(document_id).status };
+    for (const std::string_view word : query.minus_words) {
+        normalized_query.append("-"s).append(word).push_back(' ');
     }
-    const auto& word_freqs = id_word_freqs_.at(document_id);
+    return normalized_query;
+}
+
+ParsedQuery SearchServer::ParseQuery(std::string_view raw_query, QuerySyntax syntax) const {
+    ParsedQuery parsed_query;
+    auto text = std::make_shared<std::string>(raw_query);
+    Query query = ParseQueryWords(*text, true, syntax);
+    parsed_query.text_ = std::move(text);
+    parsed_query.plus_words_ = std::move(query.plus_words);
+    parsed_query.minus_words_ = std::move(query.minus_words);
+    parsed_query.phrases_ = std::move(query.phrases);
+    parsed_query.patterns_ = std::move(query.patterns);
+    return parsed_query;
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
+    const DocumentStatus status = GetDocumentData(document_id).status;
+    const Query query = ParseQueryWords(raw_query);
     std::vector<std::string_view> matched_words(query.plus_words.size());
-    const auto match_words_end = std::copy_if(query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), [&word_freqs](auto& plus_word)
-        {return  word_freqs.count(plus_word) != 0; });
-    matched_words.erase(match_words_end, matched_words.end());
-    return { matched_words, documents_.at(document_id).status };
+    matched_words.resize(MatchWords(query.plus_words, query.minus_words, id_word_freqs_.at(document_id), matched_words.data()));
+    return { matched_words, status };
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, const std::string_view raw_query, int document_id) const {
@@ -59,12 +249,13 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&, const std::string_view raw_query, int document_id) const {
+    const DocumentStatus status = GetDocumentData(document_id).status;
     bool need_sort = false;
-    const static Query query = ParseQuery(raw_query, need_sort);
-    if (std::any_of(query.minus_words.begin(), query.minus_words.end(), [this, document_id](auto& minus_word) {return id_word_freqs_.at(document_id).count(minus_word); })) {
-        return { {},  documents_.at(document_id).status };
-    }
+    const Query query = ParseQueryWords(raw_query, need_sort);
     const auto& word_freqs = id_word_freqs_.at(document_id);
+    if (std::any_of(query.minus_words.begin(), query.minus_words.end(), [&word_freqs](auto& minus_word) {return word_freqs.count(minus_word); })) {
+        return { std::vector<std::string_view>{},  status };
+    }
     std::vector<std::string_view> matched_words(query.plus_words.size());
     const auto match_words_end = std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), [&word_freqs](auto& plus_word)
         {return  word_freqs.count(plus_word) != 0; });
@@ -72,7 +263,68 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     std::sort(std::execution::par, matched_words.begin(), matched_words.end());
     auto matched_words_new_end = std::unique(std::execution::par, matched_words.begin(), matched_words.end());
     matched_words.erase(matched_words_new_end, matched_words.end());
-    return { matched_words, documents_.at(document_id).status };
+    // Слова запроса заменяются равными им словами словаря, чтобы результат не зависел от времени жизни запроса
+    for (std::string_view& word : matched_words) {
+        word = word_freqs.find(word)->first;
+    }
+    return { matched_words, status };
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const ParsedQuery& query, int document_id) const {
+    const DocumentStatus status = GetDocumentData(document_id).status;
+    if (!ContainsPhrases(query.phrases_, document_indexes_.at(document_id))) {
+        return { std::vector<std::string_view>{}, status };
+    }
+    const std::vector<std::string_view> plus_words = ExpandPlusWords(query.plus_words_, query.patterns_);
+    std::vector<std::string_view> matched_words(plus_words.size());
+    matched_words.resize(MatchWords(plus_words, query.minus_words_, id_word_freqs_.at(document_id), matched_words.data()));
+    return { matched_words, status };
+}
+
+void SearchServer::MatchDocuments(const ParsedQuery& query, const std::vector<int>& document_ids, DocumentMatches& matches) const {
+    // Проверка идёт до параллельной части: исключение из неё завершило бы программу
+    for (const int document_id : document_ids) {
+        GetDocumentData(document_id);
+    }
+
+    // Шаблоны раскрываются один раз на пакет
+    const std::vector<std::string_view> plus_words = ExpandPlusWords(query.plus_words_, query.patterns_);
+    // Каждому документу отводится место под все плюс-слова, после сопоставления слова сдвигаются вплотную
+    const size_t max_word_count = plus_words.size();
+    matches.document_ids_.assign(document_ids.begin(), document_ids.end());
+    matches.statuses_.resize(document_ids.size());
+    matches.offsets_.resize(document_ids.size() + 1);
+    matches.words_.resize(document_ids.size() * max_word_count);
+    std::for_each(std::execution::par, document_ids.begin(), document_ids.end(), [&](const int& document_id) {
+        const size_t i = &document_id - document_ids.data();
+        matches.statuses_[i] = GetDocumentData(document_id).status;
+        matches.offsets_[i + 1] = ContainsPhrases(query.phrases_, document_indexes_.at(document_id))
+            ? MatchWords(plus_words, query.minus_words_, id_word_freqs_.at(document_id), matches.words_.data() + i * max_word_count)
+            : 0;
+    });
+
+    matches.offsets_[0] = 0;
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        const size_t word_count = matches.offsets_[i + 1];
+        std::copy_n(matches.words_.begin() + i * max_word_count, word_count, matches.words_.begin() + matches.offsets_[i]);
+        matches.offsets_[i + 1] = matches.offsets_[i] + word_count;
+    }
+    matches.words_.resize(matches.offsets_.back());
+}
+
+size_t SearchServer::MatchWords(const std::vector<std::string_view>& plus_words, const std::vector<std::string_view>& minus_words,
+    const std::map<std::string_view, double>& word_freqs, std::string_view* output) const {
+    if (std::any_of(minus_words.begin(), minus_words.end(), [&word_freqs](std::string_view minus_word) { return word_freqs.count(minus_word) != 0; })) {
+        return 0;
+    }
+    size_t word_count = 0;
+    for (const std::string_view plus_word : plus_words) {
+        const auto it = word_freqs.find(plus_word);
+        if (it != word_freqs.end()) {
+            output[word_count++] = it->first;
+        }
+    }
+    return word_count;
 }
 
 /*
@@ -84,20 +336,138 @@ int SearchServer::GetDocumentId(int index) const {
 }*/
 
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {return document_status == status; });
+std::vector<Document> SearchServer::FindTopDocuments(const ParsedQuery& query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(query, document_filter::Status{ status }, top_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(raw_query, document_filter::Status{ status }, top_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, const CorpusStatistics& statistics, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(raw_query, statistics, document_filter::Status{ status }, top_count);
+}
+
+SearchPage SearchServer::FindTopDocumentsPage(const std::string_view raw_query, size_t page_index, size_t page_size, DocumentStatus status) const {
+    return FindTopDocumentsPage(raw_query, page_index, page_size, document_filter::Status{ status });
+}
+
+SearchPage SearchServer::FindTopDocumentsAfter(const std::string_view raw_query, const Document& after, size_t page_size, DocumentStatus status) const {
+    return FindTopDocumentsAfter(raw_query, after, page_size, document_filter::Status{ status });
+}
+
+void SearchServer::EnablePositionIndex(PositionIndexOptions options) {
+    if (!(options.proximity_weight >= 0.0)) {
+        throw std::invalid_argument("Вес близости слов должен быть неотрицательным"s);
+    }
+    if (!positions_) {
+        PositionIndex positions;
+        std::vector<InvertedIndex::TermId> term_sequence;
+        for (const auto [document_id, document_index] : document_indexes_) {
+            term_sequence.clear();
+            for (const std::string_view word : SplitIntoWordsNoStop(documents_[document_index].text)) {
+                term_sequence.push_back(index_.FindTerm(word));
+            }
+            positions.AddDocument(document_index, term_sequence);
+        }
+        positions_ = std::move(positions);
+    }
+    position_options_ = options;
+    // С новыми настройками меняется выдача, поэтому закэшированная должна устареть
+    ++generation_;
+}
+
+bool SearchServer::HasPositionIndex() const {
+    return positions_.has_value();
+}
+
+CorpusStatistics SearchServer::GetCorpusStatistics(std::string_view raw_query) const {
+    CorpusStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    const Query query = ParseQueryWords(raw_query);
+    for (const std::string_view word : query.plus_words) {
+        const InvertedIndex::TermId term_id = index_.FindTerm(word);
+        const int document_freq = term_id == InvertedIndex::NO_TERM ? 0 : static_cast<int>(index_.GetPostings(term_id).size());
+        statistics.document_freqs.emplace(word, document_freq);
+    }
+    return statistics;
+}
+
+std::vector<PatternStatistics> SearchServer::GetPatternStatistics(std::string_view raw_query) const {
+    // Запрос не сортируется, чтобы слова шаблонов остались на своих местах в тексте и повторы не схлопнулись
+    const Query query = ParseQueryWords(raw_query, false, QuerySyntax::PATTERNS);
+    std::map<std::string_view, std::vector<size_t>> pattern_positions;
+    for (const std::string_view pattern : query.patterns) {
+        pattern_positions[pattern].push_back(static_cast<size_t>(pattern.data() - raw_query.data()));
+    }
+    std::vector<PatternStatistics> statistics;
+    for (auto& [pattern, positions] : pattern_positions) {
+        PatternStatistics& pattern_statistics = statistics.emplace_back();
+        pattern_statistics.pattern = pattern;
+        pattern_statistics.positions = std::move(positions);
+        ForEachPatternTerm(ParseTermPattern(pattern), [this, &pattern_statistics](InvertedIndex::TermId term_id) {
+            pattern_statistics.document_freqs.emplace(index_.GetTerm(term_id), static_cast<int>(index_.GetPostings(term_id).size()));
+            return size_t(1);
+        });
+    }
+    return statistics;
+}
+
+std::vector<std::string_view> SearchServer::SuggestWords(std::string_view pattern, size_t max_count) const {
+    if (pattern.empty() || !IsValidWord(pattern) || pattern.find(' ') != std::string_view::npos) {
+        throw std::invalid_argument("Невалидный шаблон слова"s);
+    }
+    std::vector<std::string_view> words;
+    for (const InvertedIndex::TermId term_id : ExpandTermPattern(ParseTermPattern(pattern), max_count)) {
+        words.push_back(index_.GetTerm(term_id));
+    }
+    return words;
+}
+
+MetricsSnapshot SearchServer::GetMetricsSnapshot() const {
+#ifdef SEARCH_SERVER_METRICS
+    return metrics_->GetSnapshot();
+#else
+    return {};
+#endif
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const search_policy::WandPolicy& policy, const std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(policy, raw_query, document_filter::Status{ status }, top_count);
 }
 
 bool SearchServer::IsStopWord(const std::string_view& word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view& text) const {
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view& text,
+    std::vector<std::pair<std::string_view, uint32_t>>* stop_word_counts) const {
     std::vector<std::string_view> words;
-    for (const auto& word : SplitIntoWords(text)) {
+    const bool is_valid = ForEachWord(text, [this, &words, stop_word_counts](std::string_view word) {
         if (!IsStopWord(word)) {
             words.push_back(word);
         }
+        else if (stop_word_counts) {
+            stop_word_counts->push_back({ word, 1 });
+        }
+    });
+    if (!is_valid) {
+        throw std::invalid_argument("Попытка добавить документ c недопустимыми символами"s);
+    }
+    if (stop_word_counts) {
+        // Повторы стоп-слова сливаются в одну пару
+        auto& counts = *stop_word_counts;
+        std::sort(counts.begin(), counts.end());
+        size_t unique_count = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            if (unique_count > 0 && counts[unique_count - 1].first == counts[i].first) {
+                counts[unique_count - 1].second += counts[i].second;
+            }
+            else {
+                counts[unique_count++] = counts[i];
+            }
+        }
+        counts.resize(unique_count);
     }
     return words;
 }
@@ -123,13 +493,58 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
     return { text, is_minus, IsStopWord(text) };
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool need_sort) const {
+SearchServer::Query SearchServer::ParseQueryWords(std::string_view text, bool need_sort, QuerySyntax syntax) const {
     Query query;
-    for (const auto word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("В поисковом запросе недопустимые символы"s);
+    const bool has_patterns = HasSyntax(syntax, QuerySyntax::PATTERNS);
+    const bool has_phrases = HasSyntax(syntax, QuerySyntax::PHRASES);
+    // Фраза — слова между кавычкой в начале слова и кавычкой в конце слова. Стоп-слова во фразе пропускаются,
+    // как и в позициях документа. Фраза из одного слова — обычное плюс-слово.
+    // Без QuerySyntax::PHRASES кавычка — обычный символ слова.
+    bool in_phrase = false;
+    std::vector<std::string_view> phrase;
+    const bool is_valid = ForEachWord(text, [this, has_patterns, has_phrases, &query, &in_phrase, &phrase](std::string_view word) {
+        // Минус-фраз нет: кавычка после минуса — ошибка, а не начало фразы
+        if (has_phrases && !in_phrase && word.size() > 1 && word[0] == '-' && word[1] == '"') {
+            throw std::invalid_argument("Невалидный поисковый запрос"s);
+        }
+        const bool opens_phrase = has_phrases && !in_phrase && word[0] == '"';
+        if (opens_phrase) {
+            word.remove_prefix(1);
+        }
+        const bool closes_phrase = (in_phrase || opens_phrase) && !word.empty() && word.back() == '"';
+        if (closes_phrase) {
+            word.remove_suffix(1);
+        }
+        if (in_phrase || opens_phrase) {
+            if (!word.empty()) {
+                if (word[0] == '-' || word[0] == '"' || (has_patterns && IsTermPattern(word))) {
+                    throw std::invalid_argument("Невалидный поисковый запрос"s);
+                }
+                if (!IsStopWord(word)) {
+                    phrase.push_back(word);
+                    query.plus_words.push_back(word);
+                }
+            }
+            in_phrase = !closes_phrase;
+            if (closes_phrase) {
+                if (phrase.size() > 1) {
+                    query.phrases.push_back(std::move(phrase));
+                }
+                phrase.clear();
+            }
+            return;
         }
         const QueryWord query_word = ParseQueryWord(word);
+        if (has_patterns && IsTermPattern(query_word.data)) {
+            // Минус-слово с шаблоном пришлось бы раскрывать без ограничения, иначе часть документов не отсеется
+            if (query_word.is_minus) {
+                throw std::invalid_argument("Шаблоны и опечатки в минус-словах не поддерживаются"s);
+            }
+            // Разбор только проверяет шаблон, чтобы ошибка была видна сразу, а не при поиске
+            ParseTermPattern(query_word.data);
+            query.patterns.push_back(query_word.data);
+            return;
+        }
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 query.minus_words.push_back(query_word.data);
@@ -138,11 +553,25 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool need_so
                 query.plus_words.push_back(query_word.data);
             }
         }
+    });
+    if (!is_valid) {
+        throw std::invalid_argument("В поисковом запросе недопустимые символы"s);
+    }
+    if (in_phrase) {
+        throw std::invalid_argument("Незакрытая кавычка в поисковом запросе"s);
+    }
+    if (!query.phrases.empty() && !positions_) {
+        throw std::invalid_argument("Для поиска фраз нужен индекс позиций, см. EnablePositionIndex"s);
     }
     if (!need_sort) {
         return query;
     }
 
+    sort(query.phrases.begin(), query.phrases.end());
+    query.phrases.erase(std::unique(query.phrases.begin(), query.phrases.end()), query.phrases.end());
+    sort(query.patterns.begin(), query.patterns.end());
+    query.patterns.erase(std::unique(query.patterns.begin(), query.patterns.end()), query.patterns.end());
+
     sort(query.minus_words.begin(), query.minus_words.end());
     auto unique_minus_words = std::unique(query.minus_words.begin(), query.minus_words.end());
     query.minus_words.erase(unique_minus_words, query.minus_words.end());
@@ -152,15 +581,294 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool need_so
     return query;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word) const {
-    return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+const SearchServer::DocumentData& SearchServer::GetDocumentData(int document_id) const {
+    const auto it = document_indexes_.find(document_id);
+    if (it == document_indexes_.end()) {
+        throw std::out_of_range("No document with id "s + std::to_string(document_id));
+    }
+    return documents_[it->second];
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(InvertedIndex::TermId term_id, double log_document_count) const {
+    // log(N / df) = log N - log df: log df хранится в индексе и меняется только вместе со списком слова,
+    // а log N считается один раз на запрос
+    return log_document_count - index_.GetLogDocumentFreq(term_id);
+}
+
+SearchServer::ResolvedQuery SearchServer::ResolveQuery(const std::vector<std::string_view>& plus_words, const std::vector<std::string_view>& minus_words,
+    const std::vector<std::vector<std::string_view>>& phrases, const std::vector<std::string_view>& patterns,
+    const CorpusStatistics* statistics) const {
+    ResolvedQuery resolved_query;
+    for (const auto& phrase : phrases) {
+        std::vector<InvertedIndex::TermId> phrase_terms;
+        for (const std::string_view word : phrase) {
+            const InvertedIndex::TermId term_id = index_.FindTerm(word);
+            // Фразу со словом, которого нет ни в одном документе, не содержит ни один документ
+            if (term_id == InvertedIndex::NO_TERM || index_.GetPostings(term_id).empty()) {
+                return resolved_query;
+            }
+            phrase_terms.push_back(term_id);
+        }
+        resolved_query.phrases.push_back(std::move(phrase_terms));
+    }
+    if (positions_) {
+        resolved_query.proximity_weight = position_options_.proximity_weight;
+    }
+    const double log_document_count = std::log(statistics ? statistics->document_count : GetDocumentCount());
+    const auto add_plus_term = [&](InvertedIndex::TermId term_id, std::string_view word) {
+        const PostingList& postings = index_.GetPostings(term_id);
+        if (postings.empty()) {
+            return;
+        }
+        double inverse_document_freq = ComputeWordInverseDocumentFreq(term_id, log_document_count);
+        if (statistics) {
+            // Слово с документами на этом сервере обязано быть и в общей статистике
+            const auto it = statistics->document_freqs.find(word);
+            if (it == statistics->document_freqs.end() || it->second < static_cast<int>(postings.size())) {
+                throw std::invalid_argument("Общая статистика не соответствует документам сервера"s);
+            }
+            inverse_document_freq = log_document_count - std::log(static_cast<double>(it->second));
+        }
+        resolved_query.plus_terms.push_back({ term_id, &postings, inverse_document_freq });
+    };
+    for (const std::string_view word : plus_words) {
+        const InvertedIndex::TermId term_id = index_.FindTerm(word);
+        if (term_id != InvertedIndex::NO_TERM) {
+            add_plus_term(term_id, word);
+        }
+    }
+    // Слова шаблона объединяются по «или» как обычные плюс-слова, каждое со своим idf
+    for (const std::string_view pattern : patterns) {
+        for (const InvertedIndex::TermId term_id : ExpandTermPattern(ParseTermPattern(pattern), MAX_TERM_EXPANSIONS)) {
+            const auto is_added = [term_id](const QueryTerm& term) { return term.term_id == term_id; };
+            if (std::none_of(resolved_query.plus_terms.begin(), resolved_query.plus_terms.end(), is_added)) {
+                add_plus_term(term_id, index_.GetTerm(term_id));
+            }
+        }
+    }
+    for (const std::string_view word : minus_words) {
+        const InvertedIndex::TermId term_id = index_.FindTerm(word);
+        if (term_id != InvertedIndex::NO_TERM) {
+            resolved_query.minus_postings.push_back(&index_.GetPostings(term_id));
+        }
+    }
+    return resolved_query;
+}
+
+SearchServer::ResolvedQuery SearchServer::ParseAndResolveQuery(std::string_view raw_query, const CorpusStatistics* statistics) const {
+    SEARCH_METRICS_ADD(*metrics_, SearchCounter::QUERIES, 1);
+    SEARCH_METRICS_PHASE(*metrics_, SearchPhase::PARSE);
+    const Query query = ParseQueryWords(raw_query);
+    return ResolveQuery(query.plus_words, query.minus_words, query.phrases, query.patterns, statistics);
+}
+
+SearchServer::ResolvedQuery SearchServer::ResolveParsedQuery(const ParsedQuery& query) const {
+    SEARCH_METRICS_ADD(*metrics_, SearchCounter::QUERIES, 1);
+    SEARCH_METRICS_PHASE(*metrics_, SearchPhase::PARSE);
+    return ResolveQuery(query.plus_words_, query.minus_words_, query.phrases_, query.patterns_);
+}
+
+bool SearchServer::ScorePositions(const ResolvedQuery& resolved_query, int document_index, double& relevance) const {
+    for (const auto& phrase : resolved_query.phrases) {
+        if (!std::all_of(phrase.begin(), phrase.end(), [this, document_index](InvertedIndex::TermId term_id) {
+            return positions_->HasTerm(document_index, term_id);
+        })) {
+            return false;
+        }
+    }
+    for (const auto& phrase : resolved_query.phrases) {
+        if (!ContainsPhrase(phrase, document_index)) {
+            return false;
+        }
+    }
+    relevance += ComputeProximityBonus(resolved_query, document_index);
+    return true;
+}
+
+bool SearchServer::ContainsPhrase(const std::vector<InvertedIndex::TermId>& phrase, int document_index) const {
+    // Начала фразы — позиции первого слова; каждое следующее слово оставляет те начала,
+    // от которых оно стоит на своём месте
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> positions;
+    positions_->GetPositions(document_index, phrase[0], starts);
+    for (size_t offset = 1; offset < phrase.size() && !starts.empty(); ++offset) {
+        positions_->GetPositions(document_index, phrase[offset], positions);
+        size_t next = 0;
+        auto kept = starts.begin();
+        for (const uint32_t start : starts) {
+            while (next < positions.size() && positions[next] < start + offset) {
+                ++next;
+            }
+            if (next < positions.size() && positions[next] == start + offset) {
+                *kept++ = start;
+            }
+        }
+        starts.erase(kept, starts.end());
+    }
+    return !starts.empty();
+}
+
+double SearchServer::ComputeProximityBonus(const ResolvedQuery& resolved_query, int document_index) const {
+    const auto& plus_terms = resolved_query.plus_terms;
+    if (resolved_query.proximity_weight <= 0.0 || plus_terms.size() < 2) {
+        return 0.0;
+    }
+    std::vector<size_t> present_terms;
+    for (size_t i = 0; i < plus_terms.size(); ++i) {
+        if (positions_->HasTerm(document_index, plus_terms[i].term_id)) {
+            present_terms.push_back(i);
+        }
+    }
+    if (present_terms.size() < 2) {
+        return 0.0;
+    }
+
+    // Вхождения слов запроса по порядку в документе: (позиция, номер слова в plus_terms)
+    std::vector<std::pair<uint32_t, size_t>> occurrences;
+    std::vector<uint32_t> positions;
+    for (const size_t term : present_terms) {
+        positions_->GetPositions(document_index, plus_terms[term].term_id, positions);
+        for (const uint32_t position : positions) {
+            occurrences.push_back({ position, term });
+        }
+    }
+    std::sort(occurrences.begin(), occurrences.end());
+
+    // Соседние вхождения разных слов на расстоянии d добавляют каждому из них idf другого, делённый на d^2.
+    // Накопленное насыщается: прибавка слова не больше его idf, сколько бы раз слова ни стояли рядом.
+    std::vector<double> accumulators(plus_terms.size(), 0.0);
+    for (size_t i = 1; i < occurrences.size(); ++i) {
+        const auto [previous_position, previous_term] = occurrences[i - 1];
+        const auto [position, term] = occurrences[i];
+        if (term == previous_term) {
+            continue;
+        }
+        const double distance = static_cast<double>(position - previous_position);
+        accumulators[previous_term] += plus_terms[term].inverse_document_freq / (distance * distance);
+        accumulators[term] += plus_terms[previous_term].inverse_document_freq / (distance * distance);
+    }
+    double bonus = 0.0;
+    for (const size_t term : present_terms) {
+        bonus += plus_terms[term].inverse_document_freq * accumulators[term] / (1.0 + accumulators[term]);
+    }
+    return resolved_query.proximity_weight * bonus;
+}
+
+bool SearchServer::ContainsPhrases(const std::vector<std::vector<std::string_view>>& phrases, int document_index) const {
+    for (const auto& phrase : phrases) {
+        std::vector<InvertedIndex::TermId> phrase_terms;
+        for (const std::string_view word : phrase) {
+            const InvertedIndex::TermId term_id = index_.FindTerm(word);
+            if (term_id == InvertedIndex::NO_TERM || !positions_->HasTerm(document_index, term_id)) {
+                return false;
+            }
+            phrase_terms.push_back(term_id);
+        }
+        if (!ContainsPhrase(phrase_terms, document_index)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SearchServer::CheckPageSize(size_t page_size) {
+    if (page_size == 0) {
+        throw std::invalid_argument("Размер страницы должен быть больше нуля"s);
+    }
 }
 
 bool SearchServer::IsValidWord(const std::string_view word) {
     // A valid word must not contain special characters
-    return none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
-        });
+    return none_of(word.begin(), word.end(), IsControlChar);
+}
+
+bool SearchServer::IsTermPattern(std::string_view word) {
+    if (word.find_first_of("*?"sv) != std::string_view::npos) {
+        return true;
+    }
+    return (word.size() >= 2 && word.back() == '~')
+        || (word.size() >= 3 && word[word.size() - 2] == '~' && (word.back() == '1' || word.back() == '2'));
+}
+
+SearchServer::TermPattern SearchServer::ParseTermPattern(std::string_view word) {
+    TermPattern pattern{ word, 0 };
+    if (word.size() >= 2 && word.back() == '~') {
+        pattern = { word.substr(0, word.size() - 1), 1 };
+    }
+    else if (word.size() >= 3 && word[word.size() - 2] == '~' && (word.back() == '1' || word.back() == '2')) {
+        pattern = { word.substr(0, word.size() - 2), word.back() - '0' };
+    }
+    if (pattern.max_distance > 0 && pattern.text.find_first_of("*?~"sv) != std::string_view::npos) {
+        throw std::invalid_argument("Шаблон и опечатки в одном слове не поддерживаются"s);
+    }
+    if (pattern.text.size() > TermDictionary::MAX_PATTERN_LENGTH) {
+        throw std::invalid_argument("Слишком длинный шаблон слова"s);
+    }
+    return pattern;
+}
+
+std::shared_ptr<const TermDictionary> SearchServer::GetTermDictionary() const {
+    std::shared_ptr<const TermDictionary> dictionary = std::atomic_load(&term_dictionary_);
+    // Новые слова проверяются по одному, а оценки числа документов в узлах ослабевают с каждым новым документом,
+    // поэтому словарь строится заново, когда новых слов или документов больше восьмой части от бывших при построении
+    const auto is_stale = [](size_t count, size_t built_count) {
+        return count - built_count > std::max<size_t>(1024, built_count / 8);
+    };
+    if (!dictionary || is_stale(index_.GetTermCount(), dictionary->GetTermCount()) || is_stale(documents_.size(), dictionary->GetDocumentCount())) {
+        dictionary = std::make_shared<const TermDictionary>(index_, documents_.size());
+        std::atomic_store(&term_dictionary_, dictionary);
+    }
+    return dictionary;
+}
+
+std::vector<InvertedIndex::TermId> SearchServer::ExpandTermPattern(const TermPattern& pattern, size_t max_count) const {
+    std::vector<InvertedIndex::TermId> term_ids;
+    if (max_count == 0) {
+        return term_ids;
+    }
+    using Candidate = std::pair<size_t, InvertedIndex::TermId>;
+    const auto is_better = [this](const Candidate& lhs, const Candidate& rhs) {
+        return lhs.first > rhs.first || (lhs.first == rhs.first && index_.GetTerm(lhs.second) < index_.GetTerm(rhs.second));
+    };
+    // Куча из max_count слов с наибольшим числом документов, на вершине худшее из них.
+    // Из слов с равным числом документов остаются первые по алфавиту, а не найденные раньше: так набор слов
+    // не зависит от порядка обхода, и раскрытие по нескольким шардам совпадает с раскрытием на одном сервере.
+    std::vector<Candidate> best;
+    const auto add_candidate = [this, max_count, &best, &is_better](InvertedIndex::TermId term_id) {
+        const Candidate candidate{ index_.GetPostings(term_id).size(), term_id };
+        if (best.size() < max_count) {
+            best.push_back(candidate);
+            std::push_heap(best.begin(), best.end(), is_better);
+        }
+        else if (is_better(candidate, best.front())) {
+            std::pop_heap(best.begin(), best.end(), is_better);
+            best.back() = candidate;
+            std::push_heap(best.begin(), best.end(), is_better);
+        }
+        return best.size() < max_count ? size_t(1) : best.front().first;
+    };
+    ForEachPatternTerm(pattern, add_candidate);
+    std::sort(best.begin(), best.end(), is_better);
+    term_ids.reserve(best.size());
+    for (const Candidate& candidate : best) {
+        term_ids.push_back(candidate.second);
+    }
+    return term_ids;
+}
+
+std::vector<std::string_view> SearchServer::ExpandPlusWords(const std::vector<std::string_view>& plus_words, const std::vector<std::string_view>& patterns) const {
+    std::vector<std::string_view> words = plus_words;
+    if (patterns.empty()) {
+        return words;
+    }
+    for (const std::string_view pattern : patterns) {
+        for (const InvertedIndex::TermId term_id : ExpandTermPattern(ParseTermPattern(pattern), MAX_TERM_EXPANSIONS)) {
+            words.push_back(index_.GetTerm(term_id));
+        }
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
 }
 
 const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
@@ -171,16 +879,81 @@ const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id
     return empty;
 }
 
+std::vector<InvertedIndex::TermId> SearchServer::GetDocumentTerms(int document_id) const {
+    std::vector<InvertedIndex::TermId> term_ids;
+    const auto& word_freqs = GetWordFrequencies(document_id);
+    term_ids.reserve(word_freqs.size());
+    for (const auto& [word, _] : word_freqs) {
+        term_ids.push_back(index_.FindTerm(word));
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    return term_ids;
+}
+
+void SearchServer::SetStopWords(StopWordSet stop_words) {
+    if (!all_of(stop_words.begin(), stop_words.end(), IsValidWord)) {
+        throw std::invalid_argument("Some of stop words are invalid"s);
+    }
+    std::set<int> affected_indexes;
+    for (const std::string& word : stop_words) {
+        if (stop_words_.Contains(word)) {
+            continue;
+        }
+        const InvertedIndex::TermId term_id = index_.FindTerm(word);
+        if (term_id == InvertedIndex::NO_TERM) {
+            continue;
+        }
+        for (PostingCursor cursor(index_.GetPostings(term_id)); !cursor.IsEnd(); cursor.Next()) {
+            affected_indexes.insert(cursor.GetDocumentIndex());
+        }
+    }
+    // Бывших стоп-слов нет в индексе, их документы берутся из списков стоп-слов
+    for (const std::string& word : stop_words_) {
+        if (stop_words.Contains(word)) {
+            continue;
+        }
+        const InvertedIndex::TermId term_id = stop_word_index_.FindTerm(word);
+        if (term_id == InvertedIndex::NO_TERM) {
+            continue;
+        }
+        for (PostingCursor cursor(stop_word_index_.GetPostings(term_id)); !cursor.IsEnd(); cursor.Next()) {
+            affected_indexes.insert(cursor.GetDocumentIndex());
+        }
+    }
+
+    // Документ добавляется заново под тем же id: частоты всех его слов зависят от числа слов без стоп-слов.
+    // Удаляется он ещё при старых стоп-словах, чтобы снялись и его отметки в списках стоп-слов
+    // Документы копируются до удаления: удаление может сжать индексы документов
+    std::vector<std::pair<DocumentData, std::string>> affected_documents;
+    for (const int document_index : affected_indexes) {
+        const DocumentData& document = documents_[document_index];
+        affected_documents.push_back({ document, std::string(document.text) });
+    }
+    for (const auto& [document, _] : affected_documents) {
+        RemoveDocument(document.id);
+    }
+    stop_words_ = std::move(stop_words);
+    for (const auto& [document, text] : affected_documents) {
+        AddDocument(document.id, text, document.status, { document.rating });
+    }
+}
+
 void SearchServer::RemoveDocument(int document_id) {
+    const int document_index = document_indexes_.at(document_id);
     for (auto [word, _] : id_word_freqs_.at(document_id)) {
-        word_to_document_freqs_.at(word).erase(document_id);
-        if (word_to_document_freqs_.at(word).empty()) {
-            word_to_document_freqs_.erase(word);
-        }
+        index_.RemovePosting(index_.FindTerm(word), document_index);
     }
-    documents_.erase(document_id);
+    document_indexes_.erase(document_id);
     id_word_freqs_.erase(document_id);
     docs_id_.erase(document_id);
+    UpdateFilterBitmaps(document_index, false);
+    RemoveStopWordPostings(document_index);
+    if (positions_) {
+        positions_->RemoveDocument(document_index);
+    }
+    ReleaseDocumentText(document_index);
+    ReleaseDocumentIndex();
+    ++generation_;
 }
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int document_id) {
@@ -188,23 +961,144 @@ void SearchServer::RemoveDocument(const std::execution::sequenced_policy&, int d
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id) {
-    if (!documents_.count(document_id)) {
+    if (!document_indexes_.count(document_id)) {
         return;
     }
+    const int document_index = document_indexes_.at(document_id);
     vector<std::string_view> words(id_word_freqs_[document_id].size());
     std::transform(std::execution::par, id_word_freqs_.at(document_id).begin(), id_word_freqs_.at(document_id).end(), words.begin(),
         [this](const auto word) {return word.first; });
-    for_each(std::execution::par, words.begin(), words.end(), [this, &document_id](const auto word) {word_to_document_freqs_.at(word).erase(document_id); });
-    documents_.erase(document_id);
+    // Слова документа различны, поэтому каждый поток меняет свой список документов
+    for_each(std::execution::par, words.begin(), words.end(), [this, document_index](const auto word) {index_.RemovePosting(index_.FindTerm(word), document_index); });
+    document_indexes_.erase(document_id);
     id_word_freqs_.erase(document_id);
     docs_id_.erase(document_id);
+    UpdateFilterBitmaps(document_index, false);
+    RemoveStopWordPostings(document_index);
+    if (positions_) {
+        positions_->RemoveDocument(document_index);
+    }
+    ReleaseDocumentText(document_index);
+    ReleaseDocumentIndex();
+    ++generation_;
+}
+
+void SearchServer::UpdateFilterBitmaps(int document_index, bool is_present) {
+    const DocumentData& document_data = documents_[document_index];
+    DocumentBitmap& status_bitmap = status_bitmaps_[static_cast<size_t>(document_data.status)];
+    DocumentBitmap& id_parity_bitmap = id_parity_bitmaps_[document_data.id % 2];
+    if (is_present) {
+        status_bitmap.Set(document_index);
+        id_parity_bitmap.Set(document_index);
+    }
+    else {
+        status_bitmap.Reset(document_index);
+        id_parity_bitmap.Reset(document_index);
+    }
+}
+
+void SearchServer::AddStopWordPostings(int document_index, const std::vector<std::pair<std::string_view, uint32_t>>& stop_word_counts, uint32_t word_count) {
+    // Длина считается вместе со стоп-словами, чтобы не обращаться в ноль у документа из одних стоп-слов
+    uint32_t document_length = word_count;
+    for (const auto& [word, term_count] : stop_word_counts) {
+        document_length += term_count;
+    }
+    for (const auto& [word, term_count] : stop_word_counts) {
+        stop_word_index_.AddPosting(stop_word_index_.AddTerm(word), document_index, term_count, document_length);
+    }
+}
+
+void SearchServer::RemoveStopWordPostings(int document_index) {
+    if (stop_words_.size() == 0) {
+        return;
+    }
+    std::set<std::string_view> document_stop_words;
+    ForEachWord(documents_[document_index].text, [this, &document_stop_words](std::string_view word) {
+        if (IsStopWord(word)) {
+            document_stop_words.insert(word);
+        }
+    });
+    for (const std::string_view word : document_stop_words) {
+        stop_word_index_.RemovePosting(stop_word_index_.FindTerm(word), document_index);
+    }
+}
+
+DocumentBitmap SearchServer::MakeIdBitmap(const std::vector<int>& document_ids) const {
+    DocumentBitmap bitmap;
+    for (const int document_id : document_ids) {
+        const auto it = document_indexes_.find(document_id);
+        if (it != document_indexes_.end()) {
+            bitmap.Set(it->second);
+        }
+    }
+    return bitmap;
+}
+
+void SearchServer::CompactStorage() {
+    TextArena compacted;
+    for (const auto [document_id, document_index] : document_indexes_) {
+        auto& text = documents_[document_index].text;
+        text = compacted.Store(text);
+    }
+    std::swap(document_texts_, compacted);
+}
+
+void SearchServer::ReleaseDocumentText(int document_index) {
+    document_texts_.Release(documents_[document_index].text);
+    documents_[document_index].text = {};
+    if (document_texts_.GetReleasedBytes() > TextArena::DEFAULT_BLOCK_SIZE
+        && document_texts_.GetReleasedBytes() > document_texts_.GetUsedBytes()) {
+        CompactStorage();
+    }
+}
+
+void SearchServer::CompactDocumentIndexes() {
+    // Документы нумеруются заново с сохранением порядка, как в SaveSnapshot, поэтому списки документов
+    // остаются отсортированными и пересобираются дописыванием в конец
+    std::vector<int> new_indexes(documents_.size(), -1);
+    std::vector<int> old_indexes;
+    old_indexes.reserve(document_indexes_.size());
+    for (const auto [document_id, document_index] : document_indexes_) {
+        old_indexes.push_back(document_index);
+    }
+    std::sort(old_indexes.begin(), old_indexes.end());
+    std::vector<DocumentData> documents;
+    documents.reserve(old_indexes.size());
+    for (const int document_index : old_indexes) {
+        new_indexes[document_index] = static_cast<int>(documents.size());
+        documents.push_back(documents_[document_index]);
+    }
+    documents_ = std::move(documents);
+    for (auto& [document_id, document_index] : document_indexes_) {
+        document_index = new_indexes[document_index];
+    }
+
+    index_.RemapDocuments(new_indexes);
+    stop_word_index_.RemapDocuments(new_indexes);
+    if (positions_) {
+        positions_->RemapDocuments(new_indexes);
+    }
+    status_bitmaps_ = {};
+    id_parity_bitmaps_ = {};
+    for (size_t document_index = 0; document_index < documents_.size(); ++document_index) {
+        UpdateFilterBitmaps(static_cast<int>(document_index), true);
+    }
+    // Оценки словаря считают, что документов только прибавляется, поэтому он строится заново
+    std::atomic_store(&term_dictionary_, std::shared_ptr<const TermDictionary>());
+}
+
+void SearchServer::ReleaseDocumentIndex() {
+    const size_t freed_index_count = documents_.size() - document_indexes_.size();
+    if (freed_index_count > MIN_FREED_INDEX_COUNT && freed_index_count > document_indexes_.size()) {
+        CompactDocumentIndexes();
+    }
 }
 
-std::set<int>::const_iterator SearchServer::begin() {
+std::set<int>::const_iterator SearchServer::begin() const {
     return docs_id_.begin();
 }
 
 
-std::set<int>::const_iterator SearchServer::end() {
+std::set<int>::const_iterator SearchServer::end() const {
     return docs_id_.end();
 }
\ No newline at end of file
@@ -1,10 +1,21 @@
 #pragma once
 #include "string_processing.h"
-#include "concurrent_map.h"
 #include "document.h"
+#include "inverted_index.h"
+#include "top_documents.h"
+#include "text_arena.h"
+#include "document_bitmap.h"
+#include "position_index.h"
+#include "term_dictionary.h"
+#include "stop_word_set.h"
+#include "search_metrics.h"
+#include "relevance_accumulator.h"
 #include "read_input_functions.h"
 #include <algorithm>
+#include <array>
+#include <memory>
 #include <cmath>
+#include <optional>
 #include <iostream>
 #include <map>
 #include <set>
@@ -14,15 +25,35 @@
 #include <vector>
 #include <numeric>
 #include <execution>
-#include <deque>
 #include <string_view>
 #include <type_traits>
+#include <unordered_map>
+#include <thread>
 
 
 using namespace std::literals;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double COMPARISON_ACCURACY = 1e-6;
+// Сколько слов словаря подставляется вместо одного слова с шаблоном или опечаткой
+const size_t MAX_TERM_EXPANSIONS = 50;
+
+// Синтаксис запроса для SearchServer::ParseQuery, флаги объединяются через |. В обычном запросе *, ?, ~ и кавычки —
+// часть слова и ищутся буквально. Шаблоны и опечатки (кот*, к?т, кот~) разбираются только с QuerySyntax::PATTERNS,
+// фразы в кавычках ("рыжий кот") — только с QuerySyntax::PHRASES.
+enum class QuerySyntax {
+    PLAIN = 0,
+    PATTERNS = 1,
+    PHRASES = 2,
+};
+
+constexpr QuerySyntax operator|(QuerySyntax lhs, QuerySyntax rhs) {
+    return static_cast<QuerySyntax>(static_cast<int>(lhs) | static_cast<int>(rhs));
+}
+
+constexpr bool HasSyntax(QuerySyntax syntax, QuerySyntax flag) {
+    return (static_cast<int>(syntax) & static_cast<int>(flag)) != 0;
+}
 
 enum class DocumentStatus {
     ACTUAL,
@@ -31,70 +62,434 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+inline constexpr size_t DOCUMENT_STATUS_COUNT = 4;
+
+// Частые фильтры документов. Ими можно пользоваться как обычными предикатами, но поиск распознаёт их тип
+// при компиляции: статус, чётность и набор id проверяются по битовой карте документов, и блоки списков,
+// в которых нет подходящих документов, пропускаются не распаковываясь. Рейтинг проверяется по документу.
+namespace document_filter {
+    struct Status {
+        DocumentStatus status;
+
+        bool operator()(int, DocumentStatus document_status, int) const {
+            return document_status == status;
+        }
+    };
+
+    // Рейтинг в пределах [min_rating, max_rating]
+    struct RatingRange {
+        int min_rating;
+        int max_rating;
+
+        bool operator()(int, DocumentStatus, int rating) const {
+            return min_rating <= rating && rating <= max_rating;
+        }
+    };
+
+    struct IdParity {
+        bool is_odd;
+
+        bool operator()(int document_id, DocumentStatus, int) const {
+            return (document_id % 2 != 0) == is_odd;
+        }
+    };
+
+    struct IdSet {
+        explicit IdSet(std::vector<int> document_ids)
+            : ids(std::move(document_ids))
+        {
+            std::sort(ids.begin(), ids.end());
+        }
+
+        bool operator()(int document_id, DocumentStatus, int) const {
+            return std::binary_search(ids.begin(), ids.end(), document_id);
+        }
+
+        std::vector<int> ids;
+    };
+}
+
+namespace search_policy {
+    // Обход документ за документом с отсечением по верхним оценкам слов (WAND).
+    // Результат совпадает с обычным поиском, но документы, которые не могут попасть в выдачу, не оцениваются.
+    struct WandPolicy {};
+    inline constexpr WandPolicy wand{};
+}
+
+// Документ для пакетного добавления
+struct DocumentInput {
+    int id;
+    std::string_view text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
+
+// Число документов и документные частоты слов — всё, от чего зависит idf.
+// Несколько серверов с частями коллекции, ранжирующие по общей статистике, дают ту же релевантность, что и один сервер.
+struct CorpusStatistics {
+    int document_count = 0;
+    std::map<std::string, int, std::less<>> document_freqs;
+};
+
+// Слова сервера, подходящие под один шаблон запроса, и число документов у каждого, см. SearchServer::GetPatternStatistics
+struct PatternStatistics {
+    std::string pattern;
+    // Смещения всех вхождений шаблона в текст запроса, по возрастанию
+    std::vector<size_t> positions;
+    std::map<std::string, int, std::less<>> document_freqs;
+};
+
+// Настройки индекса позиций, см. SearchServer::EnablePositionIndex
+struct PositionIndexOptions {
+    // Вес прибавки к релевантности за близость слов запроса в документе; 0 — ранжирование только по tf-idf.
+    // Прибавка за слово не больше proximity_weight * его idf и растёт, чем ближе к нему другие слова запроса.
+    double proximity_weight = 0.0;
+};
+
+// Запрос, разобранный SearchServer::ParseQuery: плюс- и минус-слова без стоп-слов, отсортированные и без повторов.
+// Хранит копию текста запроса, на которую ссылаются слова, поэтому переживает исходную строку,
+// а копируется без копирования текста. Разобранный один раз запрос можно передавать в поиск и MatchDocument сколько угодно раз.
+class ParsedQuery {
+public:
+    const std::vector<std::string_view>& GetPlusWords() const;
+
+    const std::vector<std::string_view>& GetMinusWords() const;
+
+    // Фразы в кавычках из двух и более слов, слова фраз входят и в плюс-слова.
+    // Есть только у запросов, разобранных с QuerySyntax::PHRASES.
+    const std::vector<std::vector<std::string_view>>& GetPhrases() const;
+
+    // Плюс-слова с шаблоном или опечаткой (кот*, к?т, кот~), раскрываются по словарю при каждом поиске.
+    // Есть только у запросов, разобранных с QuerySyntax::PATTERNS.
+    const std::vector<std::string_view>& GetPatterns() const;
+
+private:
+    friend class SearchServer;
+
+    std::shared_ptr<const std::string> text_;
+    std::vector<std::string_view> plus_words_;
+    std::vector<std::string_view> minus_words_;
+    std::vector<std::vector<std::string_view>> phrases_;
+    std::vector<std::string_view> patterns_;
+};
+
+// Результат MatchDocuments. Слова всех документов пакета лежат в одном массиве подряд и ссылаются на словарь сервера,
+// поэтому действительны, пока жив сервер. Повторный вызов с тем же объектом переиспользует его память.
+class DocumentMatches {
+public:
+    // Совпавшие слова одного документа по возрастанию
+    struct Words {
+        const std::string_view* first;
+        const std::string_view* last;
+
+        const std::string_view* begin() const {
+            return first;
+        }
+
+        const std::string_view* end() const {
+            return last;
+        }
+
+        size_t size() const {
+            return last - first;
+        }
+    };
+
+    size_t size() const;
+
+    int GetDocumentId(size_t index) const;
+
+    DocumentStatus GetStatus(size_t index) const;
+
+    Words GetWords(size_t index) const;
+
+private:
+    friend class SearchServer;
+
+    std::vector<int> document_ids_;
+    std::vector<DocumentStatus> statuses_;
+    // Слова index-го документа — words_[offsets_[index]] .. words_[offsets_[index + 1]]
+    std::vector<size_t> offsets_;
+    std::vector<std::string_view> words_;
+};
+
+// Страница выдачи
+struct SearchPage {
+    std::vector<Document> documents;
+    // Есть ли в выдаче документы после этой страницы. Следующую страницу дёшево получить
+    // через FindTopDocumentsAfter от последнего документа этой.
+    bool has_more = false;
+};
+
+// Документ пакета, который не удалось добавить
+struct AddDocumentError {
+    int document_id;
+    std::string message;
+};
+
 class SearchServer {
 public:
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
 
+    // Стоп-слова, известные при компиляции, см. StaticStopWords
+    template <size_t N>
+    explicit SearchServer(const StaticStopWords<N>& stop_words);
+
+    explicit SearchServer(StopWordSet stop_words);
+
     explicit SearchServer(const std::string& stop_words_text);
 
     explicit SearchServer(const std::string_view stop_words_text);
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Добавляет пакет документов: разбор и подсчёт частот идут параллельно, каждый поток строит
+    // частичный индекс своей части пакета, затем части сливаются в общий индекс за один проход.
+    // Ошибочные документы пропускаются и возвращаются в порядке пакета, остальные добавляются.
+    std::vector<AddDocumentError> AddDocuments(const std::vector<DocumentInput>& documents);
    
+    // top_count — сколько лучших документов вернуть
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+
+    template <class ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <class ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const search_policy::WandPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(const search_policy::WandPolicy& policy, const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // idf считается по переданной статистике, а не по документам этого сервера
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const CorpusStatistics& statistics, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const CorpusStatistics& statistics, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ParsedQuery& query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(const ParsedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
+    // Работает и с search_policy::wand
     template <class ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const ParsedQuery& query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <class ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const ParsedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Страница номер page_index (с нуля) по page_size документов. Отбираются только документы
+    // до конца страницы, вся выдача не сортируется; для дальних страниц лучше FindTopDocumentsAfter.
+    template <typename DocumentPredicate>
+    SearchPage FindTopDocumentsPage(const std::string_view raw_query, size_t page_index, size_t page_size, DocumentPredicate document_predicate) const;
+
+    SearchPage FindTopDocumentsPage(const std::string_view raw_query, size_t page_index, size_t page_size, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    // Страница из page_size документов, идущих в выдаче сразу после after — последнего документа предыдущей страницы.
+    // Сколько бы страниц ни было пролистано, в куче лежит не больше page_size + 1 документов.
+    template <typename DocumentPredicate>
+    SearchPage FindTopDocumentsAfter(const std::string_view raw_query, const Document& after, size_t page_size, DocumentPredicate document_predicate) const;
+
+    SearchPage FindTopDocumentsAfter(const std::string_view raw_query, const Document& after, size_t page_size, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    // Начинает хранить позиции слов: после этого в запросах можно искать фразы в кавычках ("белый кот"),
+    // а при ненулевом proximity_weight документы, где слова запроса стоят рядом, поднимаются в выдаче.
+    // Позиции уже добавленных документов строятся по их текстам. Повторный вызов только меняет настройки.
+    // Снимок позиций не хранит: после LoadSearchServer индекс позиций включается заново.
+    void EnablePositionIndex(PositionIndexOptions options = {});
+
+    bool HasPositionIndex() const;
+
+    // Слова словаря, подходящие под шаблон запроса, по убыванию числа документов, при равенстве — по алфавиту.
+    // кот* — слова, начинающиеся с «кот», к?т и к*т — * заменяет любую последовательность байт, ? — один байт,
+    // кот~ и кот~2 — слова, отличающиеся от «кот» не больше чем на одну или две вставки, удаления или замены байта.
+    // Для автодополнения передаётся набранная часть слова со звёздочкой. Слова ссылаются на словарь сервера.
+    std::vector<std::string_view> SuggestWords(std::string_view pattern, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Статистика этого сервера по плюс-словам запроса
+    CorpusStatistics GetCorpusStatistics(std::string_view raw_query) const;
+
+    // Для раскрытия шаблонов по нескольким серверам: запрос разбирается с QuerySyntax::PATTERNS, и для каждого шаблона
+    // в порядке ParsedQuery::GetPatterns возвращаются места его вхождений в raw_query и все подходящие слова,
+    // у которых есть документы на этом сервере
+    std::vector<PatternStatistics> GetPatternStatistics(std::string_view raw_query) const;
+
+    // Перцентили длительности этапов поиска и счётчики с момента создания сервера.
+    // Собираются, только если сервер собран с SEARCH_SERVER_METRICS, иначе снимок пуст.
+    MetricsSnapshot GetMetricsSnapshot() const;
 
     int GetDocumentCount() const;
 
+    // Версия содержимого сервера: растёт при каждом добавлении и удалении документов.
+    // Выдача, полученная при одной версии, остаётся верной, пока версия не изменилась.
+    uint64_t GetGeneration() const;
+
+    // Запрос в каноническом виде: плюс- и минус-слова без стоп-слов, отсортированные и без повторов.
+    // Запросы с одинаковым каноническим видом дают одинаковую выдачу.
+    std::string NormalizeQuery(std::string_view raw_query) const;
+
+    // С QuerySyntax::PATTERNS слова с * и ? и слова, кончающиеся на ~, ~1 или ~2, — шаблоны, как в SuggestWords.
+    // Такие запросы передаются в поиск и MatchDocument только разобранными.
+    ParsedQuery ParseQuery(std::string_view raw_query, QuerySyntax syntax = QuerySyntax::PLAIN) const;
+
+    // Слова из MatchDocument ссылаются на словарь сервера, а не на текст запроса
+
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&, const std::string_view raw_query, int document_id) const;
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&, const std::string_view raw_query, int document_id) const;
 
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const ParsedQuery& query, int document_id) const;
+
+    // Сопоставляет запрос с каждым документом пакета параллельно и складывает результат в matches.
+    // Если какого-то документа нет, бросает std::out_of_range и не меняет matches.
+    void MatchDocuments(const ParsedQuery& query, const std::vector<int>& document_ids, DocumentMatches& matches) const;
+
    /* int GetDocumentId(int index) const;*/
-    std::set<int>::const_iterator begin();
+    std::set<int>::const_iterator begin() const;
 
-    std::set<int>::const_iterator end();
+    std::set<int>::const_iterator end() const;
 
     const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
 
+    // Идентификаторы различных слов документа по возрастанию. Одинаковые наборы слов
+    // дают одинаковые наборы идентификаторов; для отсутствующего документа набор пуст.
+    std::vector<InvertedIndex::TermId> GetDocumentTerms(int document_id) const;
+
+    // Заменяет стоп-слова. Переиндексируются только документы, в которых меняется набор слов:
+    // с новыми стоп-словами — они находятся по спискам индекса, и с бывшими стоп-словами — они находятся
+    // по спискам стоп-слов. Остальные документы не трогаются.
+    template <typename StringContainer>
+    void SetStopWords(const StringContainer& stop_words);
+
+    void SetStopWords(StopWordSet stop_words);
+
     void RemoveDocument(int document_id);
 
     void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
 
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
 
+    // Перекладывает тексты оставшихся документов в новую арену и освобождает место удалённых.
+    // RemoveDocument вызывает его сам, когда удалённые тексты занимают больше места, чем живые.
+    void CompactStorage();
+
+    // Нумерует оставшиеся документы заново подряд, с сохранением порядка, и переносит на новые индексы
+    // списки документов, позиции и карты фильтров. RemoveDocument вызывает его сам, когда освободившихся
+    // индексов больше MIN_FREED_INDEX_COUNT и больше, чем занятых.
+    void CompactDocumentIndexes();
+
 
 private:
+    friend void SaveSnapshot(const SearchServer& search_server, const std::string& path);
+    friend SearchServer LoadSearchServer(const std::string& path);
+    friend class DurableSearchServer;
+
+    static constexpr size_t MIN_FREED_INDEX_COUNT = 1024;
+
     struct DocumentData {
+        int id;
         int rating;
         DocumentStatus status;
+        std::string_view text;
     };
 
-    const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
+    StopWordSet stop_words_;
+    InvertedIndex index_;
+    // Списки документов стоп-слов. В поиске не участвуют: по ним при замене стоп-слов находятся документы
+    // бывших стоп-слов без разбора всех текстов
+    InvertedIndex stop_word_index_;
     std::map<int, std::map<std::string_view, double>> id_word_freqs_;
-    std::map<int, DocumentData> documents_;
+    // Документы по внутренним индексам: индекс выдаётся при добавлении и не переиспользуется,
+    // поэтому списки документов в индексе упорядочены по нему без пересортировки.
+    // Индексы удалённых документов освобождаются только сжатием, см. CompactDocumentIndexes
+    std::vector<DocumentData> documents_;
+    std::map<int, int> document_indexes_;
     std::set<int> docs_id_;
-    std::deque<std::string> documents_storage;
+    // Тексты документов. Слова в id_word_freqs_ и индексе ссылаются на общий словарь индекса, а не сюда,
+    // поэтому тексты можно перекладывать при сжатии
+    TextArena document_texts_;
+    uint64_t generation_ = 0;
+    // Карты фильтров: документы с каждым статусом и документы с чётными и нечётными id
+    std::array<DocumentBitmap, DOCUMENT_STATUS_COUNT> status_bitmaps_;
+    std::array<DocumentBitmap, 2> id_parity_bitmaps_;
+    // Есть, только если включён EnablePositionIndex
+    std::optional<PositionIndex> positions_;
+    PositionIndexOptions position_options_;
+    // Строится при первом поиске по шаблону; слова, появившиеся после построения, проверяются по одному,
+    // а когда их набирается много, словарь строится заново. Читается и заменяется атомарно,
+    // поэтому параллельные запросы могут перестроить его одновременно, и это безопасно.
+    mutable std::shared_ptr<const TermDictionary> term_dictionary_;
+#ifdef SEARCH_SERVER_METRICS
+    std::shared_ptr<SearchMetrics> metrics_ = std::make_shared<SearchMetrics>();
+#endif
 
     bool IsStopWord(const std::string_view& word) const;
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view& text) const;
+    // Проверяет текст на недопустимые символы тем же проходом, что и разбивает его на слова.
+    // Если передан stop_word_counts, в него записываются встреченные стоп-слова с числом вхождений
+    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view& text,
+        std::vector<std::pair<std::string_view, uint32_t>>* stop_word_counts = nullptr) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    void ReleaseDocumentText(int document_index);
+
+    // Сжимает индексы документов, если освободившихся индексов слишком много
+    void ReleaseDocumentIndex();
+
+    // Отмечает добавленный документ в картах фильтров или снимает отметки удалённого
+    void UpdateFilterBitmaps(int document_index, bool is_present);
+
+    // word_count — число слов документа без стоп-слов
+    void AddStopWordPostings(int document_index, const std::vector<std::pair<std::string_view, uint32_t>>& stop_word_counts, uint32_t word_count);
+
+    // Стоп-слова удаляемого документа находятся разбором его текста, поэтому вызывается до освобождения текста
+    void RemoveStopWordPostings(int document_index);
+
+    // Фильтры поиска проверяют документ по внутреннему индексу и по границам блока списка
+    // говорят, может ли в нём быть подходящий документ
+    struct BitmapFilter {
+        const DocumentBitmap& bitmap;
+
+        bool operator()(int document_index) const {
+            return bitmap.Test(document_index);
+        }
+
+        bool HasDocuments(int first_document_index, int last_document_index) const {
+            return bitmap.AnyInRange(first_document_index, last_document_index);
+        }
+    };
+
+    template <typename DocumentPredicate>
+    struct PredicateFilter {
+        const std::vector<DocumentData>& documents;
+        const DocumentPredicate& document_predicate;
+
+        bool operator()(int document_index) const {
+            const DocumentData& document_data = documents[document_index];
+            return document_predicate(document_data.id, document_data.status, document_data.rating);
+        }
+
+        bool HasDocuments(int /*first_document_index*/, int /*last_document_index*/) const {
+            return true;
+        }
+    };
+
+    DocumentBitmap MakeIdBitmap(const std::vector<int>& document_ids) const;
+
+    // Вызывает search с фильтром, подходящим для типа предиката
+    template <typename DocumentPredicate, typename Search>
+    std::vector<Document> WithDocumentFilter(const DocumentPredicate& document_predicate, Search search) const;
+
     struct QueryWord {
         std::string_view data;
         bool is_minus;
@@ -106,142 +501,477 @@ private:
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        std::vector<std::vector<std::string_view>> phrases;
+        std::vector<std::string_view> patterns;
+    };
+
+    Query ParseQueryWords(std::string_view text, bool need_sort = true, QuerySyntax syntax = QuerySyntax::PLAIN) const;
+
+    // Совпавшие плюс-слова документа в порядке plus_words или ни одного, если в документе есть минус-слово.
+    // Возвращает, сколько слов записано в output.
+    size_t MatchWords(const std::vector<std::string_view>& plus_words, const std::vector<std::string_view>& minus_words,
+        const std::map<std::string_view, double>& word_freqs, std::string_view* output) const;
+
+    const DocumentData& GetDocumentData(int document_id) const;
+
+    // Posting list of the term must be non-empty
+    double ComputeWordInverseDocumentFreq(InvertedIndex::TermId term_id, double log_document_count) const;
+
+    // Слово запроса, уже найденное в индексе
+    struct QueryTerm {
+        InvertedIndex::TermId term_id;
+        const PostingList* postings;
+        double inverse_document_freq;
+    };
+
+    struct ResolvedQuery {
+        // Только слова, у которых есть документы
+        std::vector<QueryTerm> plus_terms;
+        std::vector<const PostingList*> minus_postings;
+        std::vector<std::vector<InvertedIndex::TermId>> phrases;
+        double proximity_weight = 0.0;
+
+        // Нужно ли смотреть позиции слов в отобранных документах
+        bool UsesPositions() const {
+            return !phrases.empty() || proximity_weight > 0.0;
+        }
     };
 
-    Query ParseQuery(std::string_view text, bool need_sort = true) const;
+    // Каждое слово запроса ищется в словаре один раз, дальше поиск работает только с найденными списками.
+    // Если передана общая статистика, idf считается по ней.
+    ResolvedQuery ResolveQuery(const std::vector<std::string_view>& plus_words, const std::vector<std::string_view>& minus_words,
+        const std::vector<std::vector<std::string_view>>& phrases, const std::vector<std::string_view>& patterns,
+        const CorpusStatistics* statistics = nullptr) const;
+
+    ResolvedQuery ParseAndResolveQuery(std::string_view raw_query, const CorpusStatistics* statistics = nullptr) const;
+
+    ResolvedQuery ResolveParsedQuery(const ParsedQuery& query) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+    // Возвращает top_count лучших документов в порядке выдачи, не сортируя все найденные.
+    // Если задан after, только из документов, идущих в выдаче после него.
+    template <typename DocumentFilter>
+    std::vector<Document> FindAllDocuments(const ResolvedQuery& resolved_query, const DocumentFilter& filter, size_t top_count, const Document* after = nullptr) const;
 
+    template <class ExecutionPolicy, typename DocumentFilter>
+    std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const ResolvedQuery& resolved_query, const DocumentFilter& filter, size_t top_count) const;
+
+    template <typename DocumentFilter>
+    std::vector<Document> FindAllDocuments(const search_policy::WandPolicy& policy, const ResolvedQuery& resolved_query, const DocumentFilter& filter, size_t top_count) const;
+
+    // Отбирает документы после after до конца страницы и ещё один, чтобы узнать, есть ли следующая страница;
+    // первые skip документов отбрасываются
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const SearchServer::Query& query, DocumentPredicate document_predicate) const;
+    SearchPage FindPage(std::string_view raw_query, DocumentPredicate document_predicate, const Document* after, size_t skip, size_t page_size) const;
 
-    template <class ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const SearchServer::Query& query, DocumentPredicate document_predicate) const;
+    static void CheckPageSize(size_t page_size);
+
+    // Проверка документа по позициям: документ должен содержать все фразы запроса.
+    // К relevance прибавляется оценка близости слов. Позиции распаковываются, только если
+    // по таблице слов документа видно, что в нём есть все слова фраз.
+    bool ScorePositions(const ResolvedQuery& resolved_query, int document_index, double& relevance) const;
+
+    bool ContainsPhrase(const std::vector<InvertedIndex::TermId>& phrase, int document_index) const;
+
+    double ComputeProximityBonus(const ResolvedQuery& resolved_query, int document_index) const;
+
+    // Фразы для MatchDocument: документ без какой-нибудь из них не совпадает с запросом
+    bool ContainsPhrases(const std::vector<std::vector<std::string_view>>& phrases, int document_index) const;
 
     static bool IsValidWord(const std::string_view word);
+
+    // Слово запроса с шаблоном: max_distance == 0 — шаблон из * и ?, иначе допустимое число опечаток в text
+    struct TermPattern {
+        std::string_view text;
+        int max_distance;
+    };
+
+    static bool IsTermPattern(std::string_view word);
+
+    // Слово без шаблона становится шаблоном, которому подходит только оно само
+    static TermPattern ParseTermPattern(std::string_view word);
+
+    std::shared_ptr<const TermDictionary> GetTermDictionary() const;
+
+    // Передаёт в callback слова, подходящие под шаблон, см. TermDictionary::ForEachMatching
+    template <typename Callback>
+    void ForEachPatternTerm(const TermPattern& pattern, Callback callback) const;
+
+    // Не больше max_count слов, подходящих под шаблон и встречающихся в документах, в порядке SuggestWords
+    std::vector<InvertedIndex::TermId> ExpandTermPattern(const TermPattern& pattern, size_t max_count) const;
+
+    // Плюс-слова вместе со словами, на которые раскрываются шаблоны, отсортированные и без повторов
+    std::vector<std::string_view> ExpandPlusWords(const std::vector<std::string_view>& plus_words, const std::vector<std::string_view>& patterns) const;
 };
 
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+    : SearchServer(StopWordSet(stop_words))
 {
-    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
-        throw std::invalid_argument("Some of stop words are invalid"s);
-    }
+}
+
+template <size_t N>
+SearchServer::SearchServer(const StaticStopWords<N>& stop_words)
+    : SearchServer(StopWordSet(stop_words))
+{
+}
+
+template <typename StringContainer>
+void SearchServer::SetStopWords(const StringContainer& stop_words) {
+    SetStopWords(StopWordSet(stop_words));
 }
 
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
-    const Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < COMPARISON_ACCURACY) {
-            return lhs.rating > rhs.rating;
-        }
-        else {
-            return lhs.relevance > rhs.relevance;
-        }});
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    return WithDocumentFilter(document_predicate, [&](const auto& filter) {
+        return FindAllDocuments(ParseAndResolveQuery(raw_query), filter, top_count);
+    });
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, const CorpusStatistics& statistics, DocumentPredicate document_predicate, size_t top_count) const {
+    return WithDocumentFilter(document_predicate, [&](const auto& filter) {
+        return FindAllDocuments(ParseAndResolveQuery(raw_query, &statistics), filter, top_count);
+    });
 }
 
 
 
 
 template <class ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentPredicate document_predicate) const {
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
     if (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
-        return FindTopDocuments(raw_query, document_predicate);
+        return FindTopDocuments(raw_query, document_predicate, top_count);
     }
-    const Query query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-    std::sort(std::execution::par, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < COMPARISON_ACCURACY) {
-            return lhs.rating > rhs.rating;
+    return WithDocumentFilter(document_predicate, [&](const auto& filter) {
+        return FindAllDocuments(policy, ParseAndResolveQuery(raw_query), filter, top_count);
+    });
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(policy, raw_query, document_filter::Status{ status }, top_count);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const search_policy::WandPolicy& policy, const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    return WithDocumentFilter(document_predicate, [&](const auto& filter) {
+        return FindAllDocuments(policy, ParseAndResolveQuery(raw_query), filter, top_count);
+    });
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const ParsedQuery& query, DocumentPredicate document_predicate, size_t top_count) const {
+    return WithDocumentFilter(document_predicate, [&](const auto& filter) {
+        return FindAllDocuments(ResolveParsedQuery(query), filter, top_count);
+    });
+}
+
+template <class ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const ParsedQuery& query, DocumentPredicate document_predicate, size_t top_count) const {
+    return WithDocumentFilter(document_predicate, [&](const auto& filter) {
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+            return FindAllDocuments(ResolveParsedQuery(query), filter, top_count);
         }
         else {
-            return lhs.relevance > rhs.relevance;
-        }});
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+            return FindAllDocuments(policy, ResolveParsedQuery(query), filter, top_count);
+        }
+    });
+}
+
+template <class ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const ParsedQuery& query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(policy, query, document_filter::Status{ status }, top_count);
+}
+
+template <typename DocumentPredicate>
+SearchPage SearchServer::FindTopDocumentsPage(const std::string_view raw_query, size_t page_index, size_t page_size, DocumentPredicate document_predicate) const {
+    CheckPageSize(page_size);
+    // Страница за концом выдачи пуста; проверка заодно не даёт переполниться page_index * page_size
+    const size_t document_count = static_cast<size_t>(GetDocumentCount());
+    if (page_index > document_count / page_size) {
+        return {};
     }
-    return matched_documents;
+    return FindPage(raw_query, document_predicate, nullptr, page_index * page_size, page_size);
 }
 
-template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {return document_status == status; });
+template <typename DocumentPredicate>
+SearchPage SearchServer::FindTopDocumentsAfter(const std::string_view raw_query, const Document& after, size_t page_size, DocumentPredicate document_predicate) const {
+    CheckPageSize(page_size);
+    return FindPage(raw_query, document_predicate, &after, 0, page_size);
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const SearchServer::Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const auto& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+SearchPage SearchServer::FindPage(std::string_view raw_query, DocumentPredicate document_predicate, const Document* after, size_t skip, size_t page_size) const {
+    SearchPage page;
+    const size_t document_count = static_cast<size_t>(GetDocumentCount());
+    if (skip >= document_count) {
+        return page;
+    }
+    const size_t page_end = skip + std::min(page_size, document_count - skip);
+    std::vector<Document> documents = WithDocumentFilter(document_predicate, [&](const auto& filter) {
+        return FindAllDocuments(ParseAndResolveQuery(raw_query), filter, page_end + 1, after);
+    });
+    if (documents.size() > page_end) {
+        page.has_more = true;
+        documents.resize(page_end);
+    }
+    if (documents.size() > skip) {
+        page.documents.assign(documents.begin() + skip, documents.end());
+    }
+    return page;
+}
+
+template <typename DocumentPredicate, typename Search>
+std::vector<Document> SearchServer::WithDocumentFilter(const DocumentPredicate& document_predicate, Search search) const {
+    if constexpr (std::is_same_v<DocumentPredicate, document_filter::Status>) {
+        return search(BitmapFilter{ status_bitmaps_[static_cast<size_t>(document_predicate.status)] });
+    }
+    else if constexpr (std::is_same_v<DocumentPredicate, document_filter::IdParity>) {
+        return search(BitmapFilter{ id_parity_bitmaps_[document_predicate.is_odd ? 1 : 0] });
+    }
+    else if constexpr (std::is_same_v<DocumentPredicate, document_filter::IdSet>) {
+        const DocumentBitmap bitmap = MakeIdBitmap(document_predicate.ids);
+        return search(BitmapFilter{ bitmap });
+    }
+    else {
+        return search(PredicateFilter<DocumentPredicate>{ documents_, document_predicate });
+    }
+}
+
+template <typename DocumentFilter>
+std::vector<Document> SearchServer::FindAllDocuments(const ResolvedQuery& resolved_query, const DocumentFilter& filter, size_t top_count, const Document* after) const {
+    const auto has_documents = [&filter](int first, int last) { return filter.HasDocuments(first, last); };
+    RelevanceAccumulator accumulator(documents_.size(), documents_.size());
+    {
+        SEARCH_METRICS_PHASE(*metrics_, SearchPhase::POSTING_TRAVERSAL);
+        [[maybe_unused]] uint64_t postings_scanned = 0;
+        [[maybe_unused]] size_t matched_count = 0;
+        for (const auto& [term_id, postings, inverse_document_freq] : resolved_query.plus_terms) {
+            for (PostingCursor cursor(*postings, has_documents); !cursor.IsEnd(); cursor.Next(has_documents)) {
+                ++postings_scanned;
+                const int document_index = cursor.GetDocumentIndex();
+                if (accumulator.GetState(document_index) == RelevanceAccumulator::State::UNSEEN) {
+                    if (filter(document_index)) {
+                        accumulator.Match(document_index);
+                        ++matched_count;
+                    }
+                    else {
+                        accumulator.Exclude(document_index);
+                    }
+                }
+                if (accumulator.GetState(document_index) == RelevanceAccumulator::State::MATCHED) {
+                    accumulator.Add(document_index, cursor.GetTermFreq() * inverse_document_freq);
+                }
             }
         }
+        SEARCH_METRICS_ADD(*metrics_, SearchCounter::POSTINGS_SCANNED, postings_scanned);
+        SEARCH_METRICS_ADD(*metrics_, SearchCounter::DOCUMENTS_SCORED, matched_count);
     }
 
+    {
+        SEARCH_METRICS_PHASE(*metrics_, SearchPhase::MINUS_FILTER);
+        // Исключаются только уже найденные документы, чтобы не трогать лишние ячейки накопителя
+        for (const auto* postings : resolved_query.minus_postings) {
+            for (PostingCursor cursor(*postings); !cursor.IsEnd(); cursor.Next()) {
+                if (accumulator.GetState(cursor.GetDocumentIndex()) == RelevanceAccumulator::State::MATCHED) {
+                    accumulator.Exclude(cursor.GetDocumentIndex());
+                }
+            }
+        }
+    }
 
-    for (const auto& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    SEARCH_METRICS_PHASE(*metrics_, SearchPhase::TOP_K);
+    TopDocuments top_documents(top_count, after);
+    for (const size_t document_index : accumulator.GetTouchedSlots()) {
+        if (accumulator.GetState(document_index) != RelevanceAccumulator::State::MATCHED) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        double relevance = accumulator.GetRelevance(document_index);
+        if (resolved_query.UsesPositions() && !ScorePositions(resolved_query, static_cast<int>(document_index), relevance)) {
+            continue;
         }
+        const auto& document_data = documents_[document_index];
+        top_documents.Add({ document_data.id, relevance, document_data.rating });
     }
-
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
-    }
-    return matched_documents;
+    return top_documents.Extract();
 }
 
-template <class ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const SearchServer::Query& query, DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> document_to_relevance(100);
-
-    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(), [&](const auto& word) {
-        if (word_to_document_freqs_.count(word) != 0) {     
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+template <class ExecutionPolicy, typename DocumentFilter>
+std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const ResolvedQuery& resolved_query, const DocumentFilter& filter, size_t top_count) const {
+    const auto has_documents = [&filter](int first, int last) { return filter.HasDocuments(first, last); };
+    // Внутренние индексы документов делятся на непересекающиеся диапазоны.
+    // Каждый поток считает релевантность своего диапазона в собственном накопителе, поэтому блокировки не нужны.
+    const size_t part_count = std::max(1u, std::thread::hardware_concurrency());
+    const size_t part_size = (documents_.size() + part_count - 1) / part_count;
+    std::vector<TopDocuments> parts(part_count, TopDocuments(top_count));
+    std::vector<size_t> part_indexes(part_count);
+    std::iota(part_indexes.begin(), part_indexes.end(), 0);
+    std::for_each(policy, part_indexes.begin(), part_indexes.end(), [&](size_t part) {
+        const int first = static_cast<int>(std::min(part * part_size, documents_.size()));
+        const int last = static_cast<int>(std::min(first + part_size, documents_.size()));
+        if (first == last) {
+            return;
+        }
+        RelevanceAccumulator accumulator(last - first, documents_.size());
+        size_t matched_count = 0;
+
+        {
+            SEARCH_METRICS_PHASE(*metrics_, SearchPhase::MINUS_FILTER);
+            for (const auto* postings : resolved_query.minus_postings) {
+                PostingCursor cursor(*postings);
+                for (cursor.SkipTo(first); !cursor.IsEnd() && cursor.GetDocumentIndex() < last; cursor.Next()) {
+                    accumulator.Exclude(cursor.GetDocumentIndex() - first);
+                }
             }
         }
+        {
+            SEARCH_METRICS_PHASE(*metrics_, SearchPhase::POSTING_TRAVERSAL);
+            [[maybe_unused]] uint64_t postings_scanned = 0;
+            for (const auto& [term_id, postings, inverse_document_freq] : resolved_query.plus_terms) {
+                PostingCursor cursor(*postings);
+                for (cursor.SkipTo(first); !cursor.IsEnd() && cursor.GetDocumentIndex() < last; cursor.Next(has_documents)) {
+                    ++postings_scanned;
+                    const int document_index = cursor.GetDocumentIndex();
+                    const size_t slot = document_index - first;
+                    if (accumulator.GetState(slot) == RelevanceAccumulator::State::UNSEEN) {
+                        if (filter(document_index)) {
+                            accumulator.Match(slot);
+                            ++matched_count;
+                        }
+                        else {
+                            accumulator.Exclude(slot);
+                        }
+                    }
+                    if (accumulator.GetState(slot) == RelevanceAccumulator::State::MATCHED) {
+                        accumulator.Add(slot, cursor.GetTermFreq() * inverse_document_freq);
+                    }
+                }
+            }
+            SEARCH_METRICS_ADD(*metrics_, SearchCounter::POSTINGS_SCANNED, postings_scanned);
+            SEARCH_METRICS_ADD(*metrics_, SearchCounter::DOCUMENTS_SCORED, matched_count);
         }
-    });
-
-
-    std::for_each(policy, query.minus_words.begin(), query.minus_words.end(), [&](const auto& word) {
-        if (word_to_document_freqs_.count(word) != 0) {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.BuildOrdinaryMap().erase(document_id);
+        SEARCH_METRICS_PHASE(*metrics_, SearchPhase::TOP_K);
+        for (const size_t slot : accumulator.GetTouchedSlots()) {
+            if (accumulator.GetState(slot) != RelevanceAccumulator::State::MATCHED) {
+                continue;
+            }
+            const int document_index = first + static_cast<int>(slot);
+            double relevance = accumulator.GetRelevance(slot);
+            if (resolved_query.UsesPositions() && !ScorePositions(resolved_query, document_index, relevance)) {
+                continue;
             }
+            const auto& document_data = documents_[document_index];
+            parts[part].Add({ document_data.id, relevance, document_data.rating });
         }
     });
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
+    SEARCH_METRICS_PHASE(*metrics_, SearchPhase::TOP_K);
+    for (size_t part = 1; part < part_count; ++part) {
+        parts[0].Merge(parts[part]);
     }
-    return matched_documents;
+    return parts[0].Extract();
 }
 
+template <typename DocumentFilter>
+std::vector<Document> SearchServer::FindAllDocuments(const search_policy::WandPolicy&, const ResolvedQuery& resolved_query, const DocumentFilter& filter, size_t top_count) const {
+    const auto has_documents = [&filter](int first, int last) { return filter.HasDocuments(first, last); };
+    struct TermCursor {
+        PostingCursor cursor;
+        double inverse_document_freq;
+        double max_relevance;
+    };
+    // Курсор держит распакованный блок, поэтому при упорядочивании переставляются указатели на курсоры
+    std::vector<TermCursor> term_cursors;
+    term_cursors.reserve(resolved_query.plus_terms.size());
+    for (const auto& [term_id, postings, inverse_document_freq] : resolved_query.plus_terms) {
+        // Прибавка за близость к слову не больше proximity_weight * idf, поэтому верхняя оценка остаётся верной
+        const double max_relevance = inverse_document_freq * (index_.GetMaxTermFreq(term_id) + resolved_query.proximity_weight);
+        term_cursors.push_back({ PostingCursor(*postings, has_documents), inverse_document_freq, max_relevance });
+    }
+    std::vector<TermCursor*> active_cursors;
+    for (TermCursor& term : term_cursors) {
+        active_cursors.push_back(&term);
+    }
+    std::vector<PostingCursor> minus_cursors;
+    minus_cursors.reserve(resolved_query.minus_postings.size());
+    for (const auto* postings : resolved_query.minus_postings) {
+        minus_cursors.emplace_back(*postings);
+    }
+    const auto is_excluded = [&minus_cursors](int document_index) {
+        return std::any_of(minus_cursors.begin(), minus_cursors.end(), [document_index](PostingCursor& cursor) {
+            cursor.SkipTo(document_index);
+            return !cursor.IsEnd() && cursor.GetDocumentIndex() == document_index;
+        });
+    };
+
+    TopDocuments top_documents(top_count);
+    {
+        // Проверка минус-слов идёт только для опорных документов и учитывается в обходе
+        SEARCH_METRICS_PHASE(*metrics_, SearchPhase::POSTING_TRAVERSAL);
+        [[maybe_unused]] uint64_t postings_scanned = 0;
+        [[maybe_unused]] uint64_t documents_scored = 0;
+        while (true) {
+            active_cursors.erase(std::remove_if(active_cursors.begin(), active_cursors.end(), [](const TermCursor* term) { return term->cursor.IsEnd(); }), active_cursors.end());
+            std::sort(active_cursors.begin(), active_cursors.end(), [](const TermCursor* lhs, const TermCursor* rhs) {
+                return lhs->cursor.GetDocumentIndex() < rhs->cursor.GetDocumentIndex();
+            });
+
+            // Документ-опорник — первый, у которого сумма верхних оценок слов до него включительно
+            // позволяет обойти худший отобранный документ. Все документы левее него пропускаются.
+            const double threshold = top_documents.GetEntryThreshold() - COMPARISON_ACCURACY;
+            double max_relevance = 0.0;
+            size_t pivot = 0;
+            while (pivot < active_cursors.size()) {
+                max_relevance += active_cursors[pivot]->max_relevance;
+                if (max_relevance >= threshold) {
+                    break;
+                }
+                ++pivot;
+            }
+            if (pivot == active_cursors.size()) {
+                break;
+            }
+
+            const int pivot_index = active_cursors[pivot]->cursor.GetDocumentIndex();
+            if (active_cursors.front()->cursor.GetDocumentIndex() != pivot_index) {
+                for (size_t i = 0; i < pivot; ++i) {
+                    active_cursors[i]->cursor.SkipTo(pivot_index);
+                }
+                continue;
+            }
 
+            double relevance = 0.0;
+            for (TermCursor* term : active_cursors) {
+                if (term->cursor.GetDocumentIndex() != pivot_index) {
+                    break;
+                }
+                relevance += term->cursor.GetTermFreq() * term->inverse_document_freq;
+                term->cursor.Next(has_documents);
+                ++postings_scanned;
+            }
+            ++documents_scored;
+            if (!is_excluded(pivot_index) && filter(pivot_index)
+                && (!resolved_query.UsesPositions() || ScorePositions(resolved_query, pivot_index, relevance))) {
+                const auto& document_data = documents_[pivot_index];
+                top_documents.Add({ document_data.id, relevance, document_data.rating });
+            }
+        }
+        SEARCH_METRICS_ADD(*metrics_, SearchCounter::POSTINGS_SCANNED, postings_scanned);
+        SEARCH_METRICS_ADD(*metrics_, SearchCounter::DOCUMENTS_SCORED, documents_scored);
+    }
+
+    SEARCH_METRICS_PHASE(*metrics_, SearchPhase::TOP_K);
+    return top_documents.Extract();
+}
+
+template <typename Callback>
+void SearchServer::ForEachPatternTerm(const TermPattern& pattern, Callback callback) const {
+    const std::shared_ptr<const TermDictionary> dictionary = GetTermDictionary();
+    if (pattern.max_distance > 0) {
+        dictionary->ForEachSimilar(pattern.text, pattern.max_distance, index_, documents_.size(), callback);
+    }
+    else {
+        dictionary->ForEachMatching(pattern.text, index_, documents_.size(), callback);
+    }
+}
@@ -0,0 +1,180 @@
+#include "search_server_tests.h"
+#include "index_snapshot.h"
+#include "search_server.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <execution>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func, unsigned line,
+    const std::string& hint) {
+    if (!value) {
+        std::cerr << file << "("s << line << "): "s << func << ": "s << "ASSERT("s << expr_str << ") failed."s;
+        if (!hint.empty()) {
+            std::cerr << " Hint: "s << hint;
+        }
+        std::cerr << std::endl;
+        std::abort();
+    }
+}
+
+#define ASSERT(expr) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, ""s)
+
+#define ASSERT_HINT(expr, hint) AssertImpl(!!(expr), #expr, __FILE__, __FUNCTION__, __LINE__, (hint))
+
+template <typename TestFunc>
+void RunTestImpl(TestFunc func, const std::string& test_name) {
+    func();
+    std::cerr << test_name << " OK"s << std::endl;
+}
+
+#define RUN_TEST(func) RunTestImpl((func), #func)
+
+// Выдачи совпадают по порядку документов, релевантности — с точностью до COMPARISON_ACCURACY
+void AssertSameDocuments(const std::vector<Document>& lhs, const std::vector<Document>& rhs, const std::string& hint) {
+    ASSERT_HINT(lhs.size() == rhs.size(), hint);
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        ASSERT_HINT(lhs[i].id == rhs[i].id, hint);
+        ASSERT_HINT(std::abs(lhs[i].relevance - rhs[i].relevance) < COMPARISON_ACCURACY, hint);
+        ASSERT_HINT(lhs[i].rating == rhs[i].rating, hint);
+    }
+}
+
+// Небольшой словарь даёт много общих слов и равных релевантностей, на которых расходятся обходы
+std::string MakeText(std::mt19937& generator, size_t max_word_count) {
+    std::string text;
+    const size_t word_count = 1 + generator() % max_word_count;
+    for (size_t i = 0; i < word_count; ++i) {
+        text += "w"s + std::to_string(generator() % 40) + " "s;
+    }
+    return text;
+}
+
+std::string MakeQuery(std::mt19937& generator) {
+    std::string query;
+    const size_t word_count = 1 + generator() % 4;
+    for (size_t i = 0; i < word_count; ++i) {
+        query += (generator() % 4 == 0 ? "-w"s : "w"s) + std::to_string(generator() % 40) + " "s;
+    }
+    return query;
+}
+
+// Сервер после добавлений и удалений, чтобы в списках документов были и дыры, и несжатые хвосты
+SearchServer MakeServer(std::mt19937& generator, int document_count) {
+    SearchServer search_server("w0 w1"s);
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        search_server.AddDocument(document_id, MakeText(generator, 12), static_cast<DocumentStatus>(document_id % 3),
+            { static_cast<int>(generator() % 10) });
+    }
+    for (int document_id = 0; document_id < document_count; document_id += 7) {
+        search_server.RemoveDocument(document_id);
+    }
+    return search_server;
+}
+
+void TestWandMatchesTermAtATime() {
+    std::mt19937 generator(1);
+    const SearchServer search_server = MakeServer(generator, 2000);
+    for (int i = 0; i < 200; ++i) {
+        const std::string query = MakeQuery(generator);
+        for (const size_t top_count : { size_t(1), size_t(5), size_t(50) }) {
+            AssertSameDocuments(search_server.FindTopDocuments(search_policy::wand, query, DocumentStatus::ACTUAL, top_count),
+                search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_count), query);
+            AssertSameDocuments(search_server.FindTopDocuments(search_policy::wand, query, document_filter::IdParity{ true }, top_count),
+                search_server.FindTopDocuments(query, document_filter::IdParity{ true }, top_count), query);
+            AssertSameDocuments(search_server.FindTopDocuments(search_policy::wand, query, document_filter::RatingRange{ 3, 6 }, top_count),
+                search_server.FindTopDocuments(query, document_filter::RatingRange{ 3, 6 }, top_count), query);
+        }
+    }
+}
+
+void TestParallelMatchesSequential() {
+    std::mt19937 generator(2);
+    const SearchServer search_server = MakeServer(generator, 2000);
+    for (int i = 0; i < 200; ++i) {
+        // В каждом запросе есть минус-слово, и документы с ним должны отсеяться на обоих путях
+        const std::string query = MakeQuery(generator) + "-w"s + std::to_string(generator() % 40);
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const std::vector<Document> sequential = search_server.FindTopDocuments(std::execution::seq, query, status, 100);
+            AssertSameDocuments(search_server.FindTopDocuments(std::execution::par, query, status, 100), sequential, query);
+            const ParsedQuery parsed_query = search_server.ParseQuery(query);
+            for (const Document& document : sequential) {
+                for (const std::string_view minus_word : parsed_query.GetMinusWords()) {
+                    ASSERT_HINT(search_server.GetWordFrequencies(document.id).count(minus_word) == 0, query);
+                }
+            }
+        }
+    }
+}
+
+void TestPagesConcatenateToTopDocuments() {
+    std::mt19937 generator(3);
+    const SearchServer search_server = MakeServer(generator, 1000);
+    const size_t page_size = 7;
+    for (int i = 0; i < 50; ++i) {
+        const std::string query = MakeQuery(generator);
+        const std::vector<Document> all_documents = search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 1000);
+
+        std::vector<Document> by_index;
+        for (size_t page_index = 0; ; ++page_index) {
+            const SearchPage page = search_server.FindTopDocumentsPage(query, page_index, page_size);
+            by_index.insert(by_index.end(), page.documents.begin(), page.documents.end());
+            if (!page.has_more) {
+                break;
+            }
+            ASSERT_HINT(page.documents.size() == page_size, query);
+        }
+        AssertSameDocuments(by_index, all_documents, query);
+
+        std::vector<Document> by_cursor;
+        SearchPage page = search_server.FindTopDocumentsPage(query, 0, page_size);
+        by_cursor = page.documents;
+        while (page.has_more) {
+            page = search_server.FindTopDocumentsAfter(query, by_cursor.back(), page_size);
+            by_cursor.insert(by_cursor.end(), page.documents.begin(), page.documents.end());
+        }
+        AssertSameDocuments(by_cursor, all_documents, query);
+    }
+}
+
+void TestSnapshotRoundTrip() {
+    std::mt19937 generator(4);
+    const SearchServer search_server = MakeServer(generator, 1000);
+    const std::string path = "search_server_tests.snapshot"s;
+    SaveSnapshot(search_server, path);
+    {
+        const SearchServer loaded = LoadSearchServer(path);
+        const MappedSearchServer mapped(path);
+        ASSERT(loaded.GetDocumentCount() == search_server.GetDocumentCount());
+        ASSERT(mapped.GetDocumentCount() == search_server.GetDocumentCount());
+        for (int i = 0; i < 100; ++i) {
+            const std::string query = MakeQuery(generator);
+            for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT }) {
+                const std::vector<Document> expected = search_server.FindTopDocuments(query, status, 20);
+                AssertSameDocuments(loaded.FindTopDocuments(query, status, 20), expected, query);
+                AssertSameDocuments(mapped.FindTopDocuments(query, status, 20), expected, query);
+            }
+        }
+        for (const int document_id : search_server) {
+            ASSERT(loaded.GetWordFrequencies(document_id) == search_server.GetWordFrequencies(document_id));
+        }
+    }
+    std::remove(path.c_str());
+}
+
+} // namespace
+
+void TestSearchServer() {
+    RUN_TEST(TestWandMatchesTermAtATime);
+    RUN_TEST(TestParallelMatchesSequential);
+    RUN_TEST(TestPagesConcatenateToTopDocuments);
+    RUN_TEST(TestSnapshotRoundTrip);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Проверки согласованности путей поиска: WAND и обычный обход, параллельный и последовательный поиск,
+// страницы выдачи и полная выдача, сервер до сохранения снимка и после загрузки.
+// При расхождении печатают место ошибки в std::cerr и завершают программу через abort.
+void TestSearchServer();
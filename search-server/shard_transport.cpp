@@ -0,0 +1,454 @@
+#include "shard_transport.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+enum class ShardCommand : uint8_t {
+    ADD_DOCUMENT,
+    REMOVE_DOCUMENT,
+    MATCH_DOCUMENT,
+    GET_DOCUMENT_COUNT,
+    GET_CORPUS_STATISTICS,
+    FIND_TOP_DOCUMENTS,
+    GET_PATTERN_STATISTICS,
+    STOP,
+};
+
+// Длина сообщения приходит из сокета, поэтому ограничивается до выделения памяти под него:
+// испорченный или чужой собеседник не должен уронить процесс нехваткой памяти
+const uint64_t MAX_MESSAGE_SIZE = uint64_t(1) << 28;
+
+// Первый байт ответа: успех или тип исключения, за ним тело ответа или текст исключения
+enum class ShardReply : uint8_t {
+    OK,
+    INVALID_ARGUMENT,
+    OUT_OF_RANGE,
+    ERROR,
+};
+
+// Числа передаются в порядке байтов машины: оба процесса работают на одной машине
+class MessageWriter {
+public:
+    template <typename Value>
+    void Write(Value value) {
+        static_assert(std::is_trivially_copyable_v<Value>);
+        data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void WriteString(std::string_view text) {
+        Write<uint64_t>(text.size());
+        data_.append(text);
+    }
+
+    // Без длины: текст занимает весь остаток сообщения
+    void WriteRaw(std::string_view text) {
+        data_.append(text);
+    }
+
+    const std::string& GetData() const {
+        return data_;
+    }
+
+private:
+    std::string data_;
+};
+
+class MessageReader {
+public:
+    explicit MessageReader(std::string_view data)
+        : data_(data)
+    {
+    }
+
+    template <typename Value>
+    Value Read() {
+        static_assert(std::is_trivially_copyable_v<Value>);
+        Value value;
+        std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+
+    std::string_view ReadString() {
+        return Take(Read<uint64_t>());
+    }
+
+private:
+    std::string_view data_;
+
+    std::string_view Take(size_t size) {
+        if (data_.size() < size) {
+            throw std::runtime_error("Повреждённое сообщение шарда"s);
+        }
+        const std::string_view result = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return result;
+    }
+};
+
+void WriteAll(int socket, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = send(socket, data, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Ошибка записи в сокет шарда: "s + std::strerror(errno));
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// false, если соединение закрыто до первого байта
+bool ReadAll(int socket, char* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t received = recv(socket, data + done, size - done, 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Ошибка чтения из сокета шарда: "s + std::strerror(errno));
+        }
+        if (received == 0) {
+            if (done == 0) {
+                return false;
+            }
+            throw std::runtime_error("Соединение с шардом оборвалось посреди сообщения"s);
+        }
+        done += received;
+    }
+    return true;
+}
+
+void SendMessage(int socket, const std::string& message) {
+    const uint64_t size = message.size();
+    if (size > MAX_MESSAGE_SIZE) {
+        throw std::runtime_error("Сообщение шарду слишком длинное"s);
+    }
+    WriteAll(socket, reinterpret_cast<const char*>(&size), sizeof(size));
+    WriteAll(socket, message.data(), message.size());
+}
+
+std::optional<std::string> ReceiveMessage(int socket) {
+    uint64_t size = 0;
+    if (!ReadAll(socket, reinterpret_cast<char*>(&size), sizeof(size))) {
+        return std::nullopt;
+    }
+    if (size > MAX_MESSAGE_SIZE) {
+        throw std::runtime_error("Длина сообщения шарда превышает допустимую"s);
+    }
+    std::string message(size, '\0');
+    if (size > 0 && !ReadAll(socket, message.data(), size)) {
+        throw std::runtime_error("Соединение с шардом оборвалось посреди сообщения"s);
+    }
+    return message;
+}
+
+sockaddr_un MakeAddress(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Слишком длинный путь к сокету шарда "s + socket_path);
+    }
+    std::copy(socket_path.begin(), socket_path.end(), address.sun_path);
+    return address;
+}
+
+void WriteStatistics(MessageWriter& writer, const CorpusStatistics& statistics) {
+    writer.Write<int32_t>(statistics.document_count);
+    writer.Write<uint64_t>(statistics.document_freqs.size());
+    for (const auto& [word, document_freq] : statistics.document_freqs) {
+        writer.WriteString(word);
+        writer.Write<int32_t>(document_freq);
+    }
+}
+
+CorpusStatistics ReadStatistics(MessageReader& reader) {
+    CorpusStatistics statistics;
+    statistics.document_count = reader.Read<int32_t>();
+    const uint64_t word_count = reader.Read<uint64_t>();
+    for (uint64_t i = 0; i < word_count; ++i) {
+        const std::string_view word = reader.ReadString();
+        statistics.document_freqs.emplace(word, reader.Read<int32_t>());
+    }
+    return statistics;
+}
+
+// Выполняет команду над сервером и пишет тело ответа. Возвращает false на команде остановки.
+bool ExecuteCommand(SearchServer& search_server, MessageReader& request, MessageWriter& reply) {
+    switch (request.Read<ShardCommand>()) {
+    case ShardCommand::ADD_DOCUMENT: {
+        const int document_id = request.Read<int32_t>();
+        const std::string_view document = request.ReadString();
+        const auto status = static_cast<DocumentStatus>(request.Read<int32_t>());
+        std::vector<int> ratings(request.Read<uint64_t>());
+        for (int& rating : ratings) {
+            rating = request.Read<int32_t>();
+        }
+        search_server.AddDocument(document_id, document, status, ratings);
+        return true;
+    }
+    case ShardCommand::REMOVE_DOCUMENT:
+        search_server.RemoveDocument(request.Read<int32_t>());
+        return true;
+    case ShardCommand::MATCH_DOCUMENT: {
+        const std::string_view raw_query = request.ReadString();
+        const auto [words, status] = search_server.MatchDocument(raw_query, request.Read<int32_t>());
+        reply.Write<uint64_t>(words.size());
+        for (const std::string_view word : words) {
+            reply.WriteString(word);
+        }
+        reply.Write<int32_t>(static_cast<int32_t>(status));
+        return true;
+    }
+    case ShardCommand::GET_DOCUMENT_COUNT:
+        reply.Write<int32_t>(search_server.GetDocumentCount());
+        return true;
+    case ShardCommand::GET_CORPUS_STATISTICS:
+        WriteStatistics(reply, search_server.GetCorpusStatistics(request.ReadString()));
+        return true;
+    case ShardCommand::FIND_TOP_DOCUMENTS: {
+        const std::string_view raw_query = request.ReadString();
+        const CorpusStatistics statistics = ReadStatistics(request);
+        const auto status = static_cast<DocumentStatus>(request.Read<int32_t>());
+        const std::vector<Document> documents = search_server.FindTopDocuments(raw_query, statistics, status, request.Read<uint64_t>());
+        reply.Write<uint64_t>(documents.size());
+        for (const Document& document : documents) {
+            reply.Write<int32_t>(document.id);
+            reply.Write<double>(document.relevance);
+            reply.Write<int32_t>(document.rating);
+        }
+        return true;
+    }
+    case ShardCommand::GET_PATTERN_STATISTICS: {
+        const std::vector<PatternStatistics> statistics = search_server.GetPatternStatistics(request.ReadString());
+        reply.Write<uint64_t>(statistics.size());
+        for (const PatternStatistics& pattern_statistics : statistics) {
+            reply.WriteString(pattern_statistics.pattern);
+            reply.Write<uint64_t>(pattern_statistics.positions.size());
+            for (const size_t position : pattern_statistics.positions) {
+                reply.Write<uint64_t>(position);
+            }
+            reply.Write<uint64_t>(pattern_statistics.document_freqs.size());
+            for (const auto& [word, document_freq] : pattern_statistics.document_freqs) {
+                reply.WriteString(word);
+                reply.Write<int32_t>(document_freq);
+            }
+        }
+        return true;
+    }
+    case ShardCommand::STOP:
+        return false;
+    }
+    throw std::runtime_error("Неизвестная команда шарда"s);
+}
+
+} // namespace
+
+RemoteSearchShard::RemoteSearchShard(const std::string& socket_path) {
+    const sockaddr_un address = MakeAddress(socket_path);
+    socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_ < 0) {
+        throw std::runtime_error("Не удалось создать сокет: "s + std::strerror(errno));
+    }
+    if (connect(socket_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const int error = errno;
+        close(socket_);
+        throw std::runtime_error("Не удалось подключиться к шарду "s + socket_path + ": "s + std::strerror(error));
+    }
+}
+
+RemoteSearchShard::~RemoteSearchShard() {
+    close(socket_);
+}
+
+void RemoteSearchShard::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    MessageWriter request;
+    request.Write(ShardCommand::ADD_DOCUMENT);
+    request.Write<int32_t>(document_id);
+    request.WriteString(document);
+    request.Write<int32_t>(static_cast<int32_t>(status));
+    request.Write<uint64_t>(ratings.size());
+    for (const int rating : ratings) {
+        request.Write<int32_t>(rating);
+    }
+    Call(request.GetData());
+}
+
+void RemoteSearchShard::RemoveDocument(int document_id) {
+    MessageWriter request;
+    request.Write(ShardCommand::REMOVE_DOCUMENT);
+    request.Write<int32_t>(document_id);
+    Call(request.GetData());
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> RemoteSearchShard::MatchDocument(std::string_view raw_query, int document_id) const {
+    MessageWriter request;
+    request.Write(ShardCommand::MATCH_DOCUMENT);
+    request.WriteString(raw_query);
+    request.Write<int32_t>(document_id);
+    const std::string reply = Call(request.GetData());
+    MessageReader reader(reply);
+    std::vector<std::string> words(reader.Read<uint64_t>());
+    for (std::string& word : words) {
+        word = reader.ReadString();
+    }
+    return { std::move(words), static_cast<DocumentStatus>(reader.Read<int32_t>()) };
+}
+
+int RemoteSearchShard::GetDocumentCount() const {
+    MessageWriter request;
+    request.Write(ShardCommand::GET_DOCUMENT_COUNT);
+    const std::string reply = Call(request.GetData());
+    return MessageReader(reply).Read<int32_t>();
+}
+
+CorpusStatistics RemoteSearchShard::GetCorpusStatistics(std::string_view raw_query) const {
+    MessageWriter request;
+    request.Write(ShardCommand::GET_CORPUS_STATISTICS);
+    request.WriteString(raw_query);
+    const std::string reply = Call(request.GetData());
+    MessageReader reader(reply);
+    return ReadStatistics(reader);
+}
+
+std::vector<PatternStatistics> RemoteSearchShard::GetPatternStatistics(std::string_view raw_query) const {
+    MessageWriter request;
+    request.Write(ShardCommand::GET_PATTERN_STATISTICS);
+    request.WriteString(raw_query);
+    const std::string reply = Call(request.GetData());
+    MessageReader reader(reply);
+    std::vector<PatternStatistics> statistics(reader.Read<uint64_t>());
+    for (PatternStatistics& pattern_statistics : statistics) {
+        pattern_statistics.pattern = reader.ReadString();
+        pattern_statistics.positions.resize(reader.Read<uint64_t>());
+        for (size_t& position : pattern_statistics.positions) {
+            position = reader.Read<uint64_t>();
+        }
+        const uint64_t word_count = reader.Read<uint64_t>();
+        for (uint64_t i = 0; i < word_count; ++i) {
+            const std::string_view word = reader.ReadString();
+            pattern_statistics.document_freqs.emplace(word, reader.Read<int32_t>());
+        }
+    }
+    return statistics;
+}
+
+std::vector<Document> RemoteSearchShard::FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics, DocumentStatus status, size_t top_count) const {
+    MessageWriter request;
+    request.Write(ShardCommand::FIND_TOP_DOCUMENTS);
+    request.WriteString(raw_query);
+    WriteStatistics(request, statistics);
+    request.Write<int32_t>(static_cast<int32_t>(status));
+    request.Write<uint64_t>(top_count);
+    const std::string reply = Call(request.GetData());
+    MessageReader reader(reply);
+    std::vector<Document> documents(reader.Read<uint64_t>());
+    for (Document& document : documents) {
+        document.id = reader.Read<int32_t>();
+        document.relevance = reader.Read<double>();
+        document.rating = reader.Read<int32_t>();
+    }
+    return documents;
+}
+
+void RemoteSearchShard::StopServer() {
+    MessageWriter request;
+    request.Write(ShardCommand::STOP);
+    Call(request.GetData());
+}
+
+std::string RemoteSearchShard::Call(const std::string& request) const {
+    std::lock_guard guard(mutex_);
+    SendMessage(socket_, request);
+    const std::optional<std::string> reply = ReceiveMessage(socket_);
+    if (!reply || reply->empty()) {
+        throw std::runtime_error("Шард закрыл соединение"s);
+    }
+    const auto code = static_cast<ShardReply>((*reply)[0]);
+    std::string body = reply->substr(1);
+    switch (code) {
+    case ShardReply::OK:
+        return body;
+    case ShardReply::INVALID_ARGUMENT:
+        throw std::invalid_argument(body);
+    case ShardReply::OUT_OF_RANGE:
+        throw std::out_of_range(body);
+    default:
+        throw std::runtime_error(body);
+    }
+}
+
+void ServeSearchShard(SearchServer& search_server, const std::string& socket_path) {
+    const sockaddr_un address = MakeAddress(socket_path);
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        throw std::runtime_error("Не удалось создать сокет: "s + std::strerror(errno));
+    }
+    unlink(socket_path.c_str());
+    if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 1) != 0) {
+        const int error = errno;
+        close(listener);
+        throw std::runtime_error("Не удалось открыть сокет шарда "s + socket_path + ": "s + std::strerror(error));
+    }
+
+    bool running = true;
+    while (running) {
+        const int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        try {
+            while (running) {
+                const std::optional<std::string> request = ReceiveMessage(connection);
+                if (!request) {
+                    break;
+                }
+                MessageReader reader(*request);
+                MessageWriter reply;
+                try {
+                    MessageWriter body;
+                    running = ExecuteCommand(search_server, reader, body);
+                    reply.Write(ShardReply::OK);
+                    reply.WriteRaw(body.GetData());
+                }
+                catch (const std::invalid_argument& e) {
+                    reply = MessageWriter();
+                    reply.Write(ShardReply::INVALID_ARGUMENT);
+                    reply.WriteRaw(e.what());
+                }
+                catch (const std::out_of_range& e) {
+                    reply = MessageWriter();
+                    reply.Write(ShardReply::OUT_OF_RANGE);
+                    reply.WriteRaw(e.what());
+                }
+                catch (const std::exception& e) {
+                    reply = MessageWriter();
+                    reply.Write(ShardReply::ERROR);
+                    reply.WriteRaw(e.what());
+                }
+                SendMessage(connection, reply.GetData());
+            }
+        }
+        catch (const std::runtime_error&) {
+            // Соединение оборвалось, ждём следующего клиента
+        }
+        close(connection);
+    }
+    close(listener);
+    unlink(socket_path.c_str());
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "sharded_search_server.h"
+#include <mutex>
+#include <string>
+
+// Шард в отдельном процессе на этой же машине. Каждый вызов — сообщение по Unix-сокету
+// и ожидание ответа; исключения сервера шарда пробрасываются в вызывающий процесс с тем же типом.
+// Вызовы одного шарда идут по одному соединению и выполняются по очереди.
+class RemoteSearchShard : public SearchShard {
+public:
+    explicit RemoteSearchShard(const std::string& socket_path);
+
+    RemoteSearchShard(const RemoteSearchShard&) = delete;
+    RemoteSearchShard& operator=(const RemoteSearchShard&) = delete;
+
+    ~RemoteSearchShard() override;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) override;
+
+    void RemoveDocument(int document_id) override;
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const override;
+
+    int GetDocumentCount() const override;
+
+    CorpusStatistics GetCorpusStatistics(std::string_view raw_query) const override;
+
+    std::vector<PatternStatistics> GetPatternStatistics(std::string_view raw_query) const override;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics, DocumentStatus status, size_t top_count) const override;
+
+    // Просит процесс шарда завершить ServeSearchShard
+    void StopServer();
+
+private:
+    int socket_ = -1;
+    mutable std::mutex mutex_;
+
+    // Отправляет запрос и возвращает тело успешного ответа
+    std::string Call(const std::string& request) const;
+};
+
+// Обслуживает запросы RemoteSearchShard к search_server через Unix-сокет socket_path.
+// Соединения принимаются по одному. Возвращает управление, когда клиент вызывает StopServer.
+void ServeSearchShard(SearchServer& search_server, const std::string& socket_path);
@@ -0,0 +1,168 @@
+#include "sharded_search_server.h"
+#include "top_documents.h"
+#include <map>
+
+using namespace std;
+
+void LocalSearchShard::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    search_server_.AddDocument(document_id, document, status, ratings);
+}
+
+void LocalSearchShard::RemoveDocument(int document_id) {
+    search_server_.RemoveDocument(document_id);
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> LocalSearchShard::MatchDocument(std::string_view raw_query, int document_id) const {
+    const auto [words, status] = search_server_.MatchDocument(raw_query, document_id);
+    return { std::vector<std::string>(words.begin(), words.end()), status };
+}
+
+int LocalSearchShard::GetDocumentCount() const {
+    return search_server_.GetDocumentCount();
+}
+
+CorpusStatistics LocalSearchShard::GetCorpusStatistics(std::string_view raw_query) const {
+    return search_server_.GetCorpusStatistics(raw_query);
+}
+
+std::vector<PatternStatistics> LocalSearchShard::GetPatternStatistics(std::string_view raw_query) const {
+    return search_server_.GetPatternStatistics(raw_query);
+}
+
+std::vector<Document> LocalSearchShard::FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics, DocumentStatus status, size_t top_count) const {
+    return search_server_.FindTopDocuments(raw_query, statistics, status, top_count);
+}
+
+ShardedSearchServer::ShardedSearchServer(std::vector<std::unique_ptr<SearchShard>> shards)
+    : shards_(std::move(shards))
+{
+    if (shards_.empty()) {
+        throw std::invalid_argument("Нужен хотя бы один шард"s);
+    }
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Попытка добавить невалидный документ"s);
+    }
+    GetShard(document_id).AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    GetShard(document_id).RemoveDocument(document_id);
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return GetShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> ShardedSearchServer::MatchDocument(std::string_view raw_query, QuerySyntax syntax, int document_id) const {
+    CheckQuerySyntax(syntax);
+    if (!HasSyntax(syntax, QuerySyntax::PATTERNS)) {
+        return MatchDocument(raw_query, document_id);
+    }
+    return MatchDocument(ExpandTermPatterns(raw_query), document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    std::vector<CorpusStatistics> shard_statistics(shards_.size());
+    ForEachShard([&](size_t shard, const SearchShard& search_shard) {
+        shard_statistics[shard] = search_shard.GetCorpusStatistics(raw_query);
+    });
+    CorpusStatistics statistics;
+    for (const CorpusStatistics& part : shard_statistics) {
+        statistics.document_count += part.document_count;
+        for (const auto& [word, document_freq] : part.document_freqs) {
+            statistics.document_freqs[word] += document_freq;
+        }
+    }
+
+    // Лучшие документы всей коллекции входят в лучшие своего шарда, поэтому от каждого шарда нужно top_count документов
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    ForEachShard([&](size_t shard, const SearchShard& search_shard) {
+        shard_documents[shard] = search_shard.FindTopDocuments(raw_query, statistics, status, top_count);
+    });
+    TopDocuments top_documents(top_count);
+    for (const auto& documents : shard_documents) {
+        for (const Document& document : documents) {
+            top_documents.Add(document);
+        }
+    }
+    return top_documents.Extract();
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, QuerySyntax syntax, DocumentStatus status, size_t top_count) const {
+    CheckQuerySyntax(syntax);
+    if (!HasSyntax(syntax, QuerySyntax::PATTERNS)) {
+        return FindTopDocuments(raw_query, status, top_count);
+    }
+    return FindTopDocuments(ExpandTermPatterns(raw_query), status, top_count);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const auto& shard : shards_) {
+        document_count += shard->GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+SearchShard& ShardedSearchServer::GetShard(int document_id) const {
+    if (document_id < 0) {
+        throw std::out_of_range("Документа с таким id нет"s);
+    }
+    return *shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+void ShardedSearchServer::CheckQuerySyntax(QuerySyntax syntax) {
+    if (HasSyntax(syntax, QuerySyntax::PHRASES)) {
+        throw std::invalid_argument("Фразы в кавычках в шардах не поддерживаются"s);
+    }
+}
+
+std::string ShardedSearchServer::ExpandTermPatterns(std::string_view raw_query) const {
+    std::vector<std::vector<PatternStatistics>> shard_patterns(shards_.size());
+    ForEachShard([&](size_t shard, const SearchShard& search_shard) {
+        shard_patterns[shard] = search_shard.GetPatternStatistics(raw_query);
+    });
+
+    // Шарды разбирают запрос одинаково, поэтому шаблоны и места их вхождений у всех одни и те же и в одном порядке
+    std::string expanded_query(raw_query);
+    std::vector<std::string_view> expansions;
+    for (size_t i = 0; i < shard_patterns[0].size(); ++i) {
+        const PatternStatistics& pattern = shard_patterns[0][i];
+        // Слова шаблона затираются пробелами по местам, найденным разбором, а не по тексту слова:
+        // остальные слова запроса остаются нетронутыми, даже если совпадают с шаблоном буквально
+        for (const size_t position : pattern.positions) {
+            expanded_query.replace(position, pattern.pattern.size(), pattern.pattern.size(), ' ');
+        }
+        std::map<std::string_view, int> document_freqs;
+        for (const auto& pattern_statistics : shard_patterns) {
+            for (const auto& [word, document_freq] : pattern_statistics[i].document_freqs) {
+                document_freqs[word] += document_freq;
+            }
+        }
+        // Тот же порядок, что у SearchServer: по убыванию числа документов, при равенстве — по алфавиту
+        std::vector<std::pair<std::string_view, int>> words(document_freqs.begin(), document_freqs.end());
+        const size_t expansion_count = std::min(words.size(), MAX_TERM_EXPANSIONS);
+        std::partial_sort(words.begin(), words.begin() + expansion_count, words.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+        });
+        for (size_t j = 0; j < expansion_count; ++j) {
+            // Слово документа, начинающееся с минуса, в запросе прочиталось бы как минус-слово, поэтому не подставляется
+            if (words[j].first[0] != '-') {
+                expansions.push_back(words[j].first);
+            }
+        }
+    }
+
+    for (const std::string_view word : expansions) {
+        expanded_query.push_back(' ');
+        expanded_query.append(word);
+    }
+    return expanded_query;
+}
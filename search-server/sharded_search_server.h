@@ -0,0 +1,140 @@
+#pragma once
+#include "search_server.h"
+#include "document.h"
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <execution>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Часть коллекции ShardedSearchServer: сервер в этом же процессе или в отдельном (см. shard_transport.h).
+// Слова из MatchDocument возвращаются строками, потому что сервер шарда может жить в другом процессе.
+class SearchShard {
+public:
+    virtual ~SearchShard() = default;
+
+    virtual void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) = 0;
+
+    virtual void RemoveDocument(int document_id) = 0;
+
+    virtual std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const = 0;
+
+    virtual int GetDocumentCount() const = 0;
+
+    virtual CorpusStatistics GetCorpusStatistics(std::string_view raw_query) const = 0;
+
+    virtual std::vector<PatternStatistics> GetPatternStatistics(std::string_view raw_query) const = 0;
+
+    virtual std::vector<Document> FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics, DocumentStatus status, size_t top_count) const = 0;
+};
+
+class LocalSearchShard : public SearchShard {
+public:
+    template <typename StopWords>
+    explicit LocalSearchShard(const StopWords& stop_words);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) override;
+
+    void RemoveDocument(int document_id) override;
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const override;
+
+    int GetDocumentCount() const override;
+
+    CorpusStatistics GetCorpusStatistics(std::string_view raw_query) const override;
+
+    std::vector<PatternStatistics> GetPatternStatistics(std::string_view raw_query) const override;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const CorpusStatistics& statistics, DocumentStatus status, size_t top_count) const override;
+
+private:
+    SearchServer search_server_;
+};
+
+// Сервер, разбивающий документы по id между несколькими шардами.
+// Добавление, удаление и MatchDocument идут в шард, которому принадлежит документ.
+// Поиск идёт в два параллельных прохода по всем шардам: сначала собирается общая статистика слов запроса,
+// затем каждый шард ищет лучшие документы с idf по этой статистике, и их выдачи сливаются.
+// Поэтому релевантность совпадает с релевантностью одного сервера со всеми документами.
+// Шаблоны и опечатки (QuerySyntax::PATTERNS) раскрываются здесь один раз по словам всех шардов с общим числом документов,
+// а шардам уходит запрос с готовыми словами, поэтому и раскрытие совпадает с раскрытием на одном сервере.
+class ShardedSearchServer {
+public:
+    template <typename StopWords>
+    ShardedSearchServer(const StopWords& stop_words, size_t shard_count);
+
+    explicit ShardedSearchServer(std::vector<std::unique_ptr<SearchShard>> shards);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, QuerySyntax syntax, int document_id) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, QuerySyntax syntax, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+private:
+    std::vector<std::unique_ptr<SearchShard>> shards_;
+
+    SearchShard& GetShard(int document_id) const;
+
+    // Шарды не хранят позиций слов, поэтому фразы (QuerySyntax::PHRASES) отклоняются
+    static void CheckQuerySyntax(QuerySyntax syntax);
+
+    // Запрос, в котором шаблоны заменены словами, на которые их раскрыл бы один сервер со всеми документами
+    std::string ExpandTermPatterns(std::string_view raw_query) const;
+
+    // Вызывает function для всех шардов параллельно. Исключение из шарда пробрасывается после завершения всех вызовов.
+    template <typename Function>
+    void ForEachShard(Function function) const;
+};
+
+template <typename StopWords>
+LocalSearchShard::LocalSearchShard(const StopWords& stop_words)
+    : search_server_(stop_words)
+{
+}
+
+template <typename StopWords>
+ShardedSearchServer::ShardedSearchServer(const StopWords& stop_words, size_t shard_count) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Нужен хотя бы один шард"s);
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<LocalSearchShard>(stop_words));
+    }
+}
+
+template <typename Function>
+void ShardedSearchServer::ForEachShard(Function function) const {
+    // Исключение, вылетевшее из параллельного алгоритма, завершило бы программу
+    std::vector<std::exception_ptr> errors(shards_.size());
+    std::vector<size_t> shard_indexes(shards_.size());
+    std::iota(shard_indexes.begin(), shard_indexes.end(), 0);
+    std::for_each(std::execution::par, shard_indexes.begin(), shard_indexes.end(), [&](size_t shard) {
+        try {
+            function(shard, *shards_[shard]);
+        }
+        catch (...) {
+            errors[shard] = std::current_exception();
+        }
+    });
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
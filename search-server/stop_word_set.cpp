@@ -0,0 +1,35 @@
+#include "stop_word_set.h"
+
+using namespace std;
+
+StopWordSet::StopWordSet() {
+    Build();
+}
+
+size_t StopWordSet::size() const {
+    return words_.size();
+}
+
+std::vector<std::string>::const_iterator StopWordSet::begin() const {
+    return words_.begin();
+}
+
+std::vector<std::string>::const_iterator StopWordSet::end() const {
+    return words_.end();
+}
+
+void StopWordSet::Build() {
+    bucket_seeds_.assign(stop_word_hash::GetBucketCount(words_.size()), 0);
+    slots_.assign(stop_word_hash::GetSlotCount(words_.size()), 0);
+    length_mask_ = 0;
+    for (const std::string& word : words_) {
+        length_mask_ |= stop_word_hash::GetLengthBit(word.size());
+    }
+    std::vector<uint64_t> hashes(words_.size());
+    std::vector<uint32_t> order(words_.size());
+    std::vector<uint32_t> bucket_starts(bucket_seeds_.size() + 1);
+    // Слова уже без повторов, поэтому неудача значила бы, что смещение не нашлось за MAX_SEED попыток
+    if (!stop_word_hash::Build(words_, words_.size(), bucket_seeds_, bucket_seeds_.size(), slots_, slots_.size(), hashes, order, bucket_starts)) {
+        throw std::logic_error("Не удалось построить таблицу стоп-слов"s);
+    }
+}
@@ -0,0 +1,248 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+// Совершенное хеширование стоп-слов. Слово сначала проверяется по маске длин стоп-слов, затем хешируется один раз:
+// старшая половина хеша выбирает корзину, а подобранное при построении смещение корзины — ячейку таблицы,
+// в которой может лежать только это слово. Проверка — одно сравнение строк вместо спуска по дереву.
+// Ячеек не меньше чем вдвое больше слов, поэтому смещение для корзины находится за несколько попыток.
+namespace stop_word_hash {
+    inline constexpr uint32_t MAX_SEED = 1 << 16;
+
+    // FNV-1a
+    constexpr uint64_t Hash(std::string_view word) {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (const char byte : word) {
+            hash ^= static_cast<unsigned char>(byte);
+            hash *= 0x100000001B3ULL;
+        }
+        return hash;
+    }
+
+    constexpr size_t GetBucket(uint64_t hash, size_t bucket_count) {
+        return static_cast<size_t>((hash >> 32) % bucket_count);
+    }
+
+    constexpr size_t GetSlot(uint64_t hash, uint32_t seed, size_t slot_count) {
+        // Перемешивание из splitmix64
+        uint64_t x = hash + seed * 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return static_cast<size_t>((x ^ (x >> 31)) & (slot_count - 1));
+    }
+
+    constexpr size_t GetBucketCount(size_t word_count) {
+        return word_count > 0 ? word_count : 1;
+    }
+
+    constexpr size_t GetSlotCount(size_t word_count) {
+        size_t slot_count = 1;
+        while (slot_count < 2 * word_count) {
+            slot_count *= 2;
+        }
+        return slot_count;
+    }
+
+    // Слова длиннее 62 байт делят один бит
+    constexpr uint64_t GetLengthBit(size_t length) {
+        return uint64_t(1) << (length < 63 ? length : 63);
+    }
+
+    // Подбирает смещения корзин и раскладывает слова по ячейкам: в ячейке номер слова + 1, 0 — пусто.
+    // hashes, order и bucket_starts — рабочая память на word_count, word_count и bucket_count + 1 элементов.
+    // false, если слова повторяются. Годится и для массивов при компиляции, и для векторов.
+    template <typename Words, typename Seeds, typename Slots, typename Hashes, typename Order, typename BucketStarts>
+    constexpr bool Build(const Words& words, size_t word_count, Seeds& bucket_seeds, size_t bucket_count, Slots& slots, size_t slot_count,
+        Hashes& hashes, Order& order, BucketStarts& bucket_starts);
+
+    template <typename Words, typename Seeds, typename Slots>
+    constexpr bool Contains(std::string_view word, const Words& words, const Seeds& bucket_seeds, size_t bucket_count,
+        const Slots& slots, size_t slot_count, uint64_t length_mask);
+}
+
+// Стоп-слова, известные при компиляции: таблица строится компилятором, а на старте копируется без хеширования.
+//     constexpr StaticStopWords STOP_WORDS(std::array{ "и"sv, "в"sv, "на"sv });
+//     SearchServer search_server(STOP_WORDS);
+template <size_t N>
+class StaticStopWords {
+public:
+    static constexpr size_t BUCKET_COUNT = stop_word_hash::GetBucketCount(N);
+    static constexpr size_t SLOT_COUNT = stop_word_hash::GetSlotCount(N);
+
+    constexpr explicit StaticStopWords(const std::array<std::string_view, N>& words);
+
+    constexpr bool Contains(std::string_view word) const {
+        return stop_word_hash::Contains(word, words_, bucket_seeds_, BUCKET_COUNT, slots_, SLOT_COUNT, length_mask_);
+    }
+
+    constexpr size_t size() const {
+        return N;
+    }
+
+    constexpr auto begin() const {
+        return words_.begin();
+    }
+
+    constexpr auto end() const {
+        return words_.end();
+    }
+
+private:
+    friend class StopWordSet;
+
+    std::array<std::string_view, N> words_;
+    std::array<uint32_t, BUCKET_COUNT> bucket_seeds_{};
+    std::array<uint32_t, SLOT_COUNT> slots_{};
+    uint64_t length_mask_ = 0;
+};
+
+// Неизменяемый набор стоп-слов сервера. Строится один раз в конструкторе сервера или при замене стоп-слов.
+class StopWordSet {
+public:
+    StopWordSet();
+
+    // Пустые строки и повторы отбрасываются
+    template <typename StringContainer>
+    explicit StopWordSet(const StringContainer& stop_words);
+
+    template <size_t N>
+    explicit StopWordSet(const StaticStopWords<N>& stop_words);
+
+    bool Contains(std::string_view word) const {
+        return stop_word_hash::Contains(word, words_, bucket_seeds_, bucket_seeds_.size(), slots_, slots_.size(), length_mask_);
+    }
+
+    size_t size() const;
+
+    // Слова в порядке построения
+    std::vector<std::string>::const_iterator begin() const;
+
+    std::vector<std::string>::const_iterator end() const;
+
+private:
+    std::vector<std::string> words_;
+    std::vector<uint32_t> bucket_seeds_;
+    std::vector<uint32_t> slots_;
+    uint64_t length_mask_ = 0;
+
+    void Build();
+};
+
+template <typename Words, typename Seeds, typename Slots, typename Hashes, typename Order, typename BucketStarts>
+constexpr bool stop_word_hash::Build(const Words& words, size_t word_count, Seeds& bucket_seeds, size_t bucket_count, Slots& slots, size_t slot_count,
+    Hashes& hashes, Order& order, BucketStarts& bucket_starts) {
+    // Слова раскладываются по корзинам подсчётом: слова корзины bucket — order[bucket_starts[bucket]..bucket_starts[bucket + 1])
+    for (size_t bucket = 0; bucket <= bucket_count; ++bucket) {
+        bucket_starts[bucket] = 0;
+    }
+    for (size_t i = 0; i < word_count; ++i) {
+        hashes[i] = Hash(words[i]);
+        ++bucket_starts[GetBucket(hashes[i], bucket_count) + 1];
+    }
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        bucket_starts[bucket + 1] += bucket_starts[bucket];
+    }
+    for (size_t i = 0; i < word_count; ++i) {
+        order[bucket_starts[GetBucket(hashes[i], bucket_count)]++] = static_cast<uint32_t>(i);
+    }
+    for (size_t bucket = bucket_count; bucket > 0; --bucket) {
+        bucket_starts[bucket] = bucket_starts[bucket - 1];
+    }
+    bucket_starts[0] = 0;
+
+    for (size_t slot = 0; slot < slot_count; ++slot) {
+        slots[slot] = 0;
+    }
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+        bool is_placed = false;
+        for (uint32_t seed = 0; seed < MAX_SEED && !is_placed; ++seed) {
+            is_placed = true;
+            for (size_t k = bucket_starts[bucket]; k < bucket_starts[bucket + 1] && is_placed; ++k) {
+                const size_t i = order[k];
+                const size_t slot = GetSlot(hashes[i], seed, slot_count);
+                if (slots[slot] == 0) {
+                    slots[slot] = static_cast<uint32_t>(i + 1);
+                    continue;
+                }
+                // Одинаковые слова попадают в одну ячейку при любом смещении
+                if (std::string_view(words[slots[slot] - 1]) == std::string_view(words[i])) {
+                    return false;
+                }
+                is_placed = false;
+            }
+            if (is_placed) {
+                bucket_seeds[bucket] = seed;
+                continue;
+            }
+            for (size_t k = bucket_starts[bucket]; k < bucket_starts[bucket + 1]; ++k) {
+                const size_t i = order[k];
+                const size_t slot = GetSlot(hashes[i], seed, slot_count);
+                if (slots[slot] == i + 1) {
+                    slots[slot] = 0;
+                }
+            }
+        }
+        if (!is_placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Words, typename Seeds, typename Slots>
+constexpr bool stop_word_hash::Contains(std::string_view word, const Words& words, const Seeds& bucket_seeds, size_t bucket_count,
+    const Slots& slots, size_t slot_count, uint64_t length_mask) {
+    if ((length_mask & GetLengthBit(word.size())) == 0) {
+        return false;
+    }
+    const uint64_t hash = Hash(word);
+    const uint32_t slot = slots[GetSlot(hash, bucket_seeds[GetBucket(hash, bucket_count)], slot_count)];
+    return slot != 0 && std::string_view(words[slot - 1]) == word;
+}
+
+template <size_t N>
+constexpr StaticStopWords<N>::StaticStopWords(const std::array<std::string_view, N>& words)
+    : words_(words)
+{
+    std::array<uint64_t, N> hashes{};
+    std::array<uint32_t, N> order{};
+    std::array<uint32_t, BUCKET_COUNT + 1> bucket_starts{};
+    for (const std::string_view word : words_) {
+        if (word.empty()) {
+            throw std::invalid_argument("Пустое стоп-слово"s);
+        }
+        length_mask_ |= stop_word_hash::GetLengthBit(word.size());
+    }
+    if (!stop_word_hash::Build(words_, N, bucket_seeds_, BUCKET_COUNT, slots_, SLOT_COUNT, hashes, order, bucket_starts)) {
+        throw std::invalid_argument("Стоп-слова повторяются"s);
+    }
+}
+
+template <typename StringContainer>
+StopWordSet::StopWordSet(const StringContainer& stop_words) {
+    for (const auto& word : stop_words) {
+        if (!std::string_view(word).empty()) {
+            words_.emplace_back(word);
+        }
+    }
+    std::sort(words_.begin(), words_.end());
+    words_.erase(std::unique(words_.begin(), words_.end()), words_.end());
+    Build();
+}
+
+template <size_t N>
+StopWordSet::StopWordSet(const StaticStopWords<N>& stop_words)
+    : words_(stop_words.words_.begin(), stop_words.words_.end())
+    , bucket_seeds_(stop_words.bucket_seeds_.begin(), stop_words.bucket_seeds_.end())
+    , slots_(stop_words.slots_.begin(), stop_words.slots_.end())
+    , length_mask_(stop_words.length_mask_)
+{
+}
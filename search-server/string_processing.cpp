@@ -1,25 +1,112 @@
 #include "string_processing.h"
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 
-std::vector<std::string> SplitIntoWords(const std::string& text) {
-    std::vector<std::string> words;
-    std::string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
+bool IsControlChar(char c) {
+    return static_cast<unsigned char>(c) < static_cast<unsigned char>(' ');
+}
+
+const char* FindWordEnd(const char* begin, const char* end, bool& has_control_chars) {
+    const char* pos = begin;
+    // Байт подходит, если это пробел или код не больше 31: min(c, 31) == c
+#if defined(__AVX2__)
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i max_control = _mm256_set1_epi8(' ' - 1);
+    while (end - pos >= 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+        const __m256i is_space = _mm256_cmpeq_epi8(chunk, spaces);
+        const __m256i is_control = _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, max_control), chunk);
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(is_space, is_control)));
+        while (mask != 0) {
+            const char* found = pos + __builtin_ctz(mask);
+            if (*found == ' ') {
+                return found;
             }
+            has_control_chars = true;
+            mask &= mask - 1;
         }
-        else {
-            word += c;
+        pos += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i spaces_16 = _mm_set1_epi8(' ');
+    const __m128i max_control_16 = _mm_set1_epi8(' ' - 1);
+    while (end - pos >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        const __m128i is_space = _mm_cmpeq_epi8(chunk, spaces_16);
+        const __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, max_control_16), chunk);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(is_space, is_control)));
+        while (mask != 0) {
+            const char* found = pos + __builtin_ctz(mask);
+            if (*found == ' ') {
+                return found;
+            }
+            has_control_chars = true;
+            mask &= mask - 1;
         }
+        pos += 16;
     }
-    if (!word.empty()) {
-        words.push_back(word);
+#endif
+    for (; pos != end; ++pos) {
+        if (*pos == ' ') {
+            return pos;
+        }
+        if (IsControlChar(*pos)) {
+            has_control_chars = true;
+        }
     }
+    return end;
+}
+
+WordRange::Iterator::Iterator(const char* pos, const char* end)
+    : end_(end)
+{
+    FindWord(pos);
+}
+
+WordRange::Iterator::reference WordRange::Iterator::operator*() const {
+    return word_;
+}
+
+WordRange::Iterator& WordRange::Iterator::operator++() {
+    FindWord(word_.data() + word_.size());
+    return *this;
+}
 
-    return words;
+bool WordRange::Iterator::operator==(const Iterator& other) const {
+    return word_.data() == other.word_.data();
 }
 
+bool WordRange::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+void WordRange::Iterator::FindWord(const char* pos) {
+    while (pos != end_ && *pos == ' ') {
+        ++pos;
+    }
+    bool has_control_chars = false;
+    word_ = std::string_view(pos, FindWordEnd(pos, end_, has_control_chars) - pos);
+}
+
+WordRange::WordRange(std::string_view text)
+    : text_(text)
+{
+}
+
+WordRange::Iterator WordRange::begin() const {
+    return { text_.data(), text_.data() + text_.size() };
+}
+
+WordRange::Iterator WordRange::end() const {
+    const char* text_end = text_.data() + text_.size();
+    return { text_end, text_end };
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+    const WordRange words(text);
+    return { words.begin(), words.end() };
+}
@@ -1,23 +1,97 @@
 #pragma once
 #include "search_server.h"
+#include <cstddef>
+#include <iterator>
 #include <vector>
 #include <set>
 #include <string>
+#include <string_view>
 
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
+// Управляющие символы (коды 0..31) в словах недопустимы
+bool IsControlChar(char c);
+
+// Возвращает позицию первого пробела или конца текста, начиная с begin.
+// Если по пути встретился управляющий символ, выставляет has_control_chars.
+// Где доступен SSE2/AVX2, текст просматривается по 16/32 байта за шаг.
+const char* FindWordEnd(const char* begin, const char* end, bool& has_control_chars);
+
+// Слова текста, разделённые пробелами, без выделения памяти.
+// Слова указывают на исходный текст, он должен пережить диапазон.
+class WordRange {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        Iterator(const char* pos, const char* end);
+
+        reference operator*() const;
+
+        Iterator& operator++();
+
+        bool operator==(const Iterator& other) const;
+
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        void FindWord(const char* pos);
+
+        const char* end_;
+        std::string_view word_;
+    };
+
+    explicit WordRange(std::string_view text);
+
+    Iterator begin() const;
+
+    Iterator end() const;
+
+private:
+    std::string_view text_;
+};
+
+// Вызывает callback для каждого слова текста.
+// Возвращает false, если в тексте есть управляющие символы; разбор при этом не прерывается.
+template <typename Callback>
+bool ForEachWord(std::string_view text, Callback&& callback);
+
+// Слова указывают на исходный текст, он должен пережить результат
+std::vector<std::string_view> SplitIntoWords(std::string_view text);
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings);
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings);
+
+template <typename Callback>
+bool ForEachWord(std::string_view text, Callback&& callback) {
+    bool has_control_chars = false;
+    const char* pos = text.data();
+    const char* const end = text.data() + text.size();
+    while (true) {
+        while (pos != end && *pos == ' ') {
+            ++pos;
+        }
+        if (pos == end) {
+            break;
+        }
+        const char* word_end = FindWordEnd(pos, end, has_control_chars);
+        callback(std::string_view(pos, word_end - pos));
+        pos = word_end;
+    }
+    return !has_control_chars;
+}
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
-    for (const std::string& str : strings) {
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
+    for (const auto& str : strings) {
         if (!str.empty()) {
-            non_empty_strings.insert(str);
+            non_empty_strings.emplace(str);
         }
     }
     return non_empty_strings;
 }
-
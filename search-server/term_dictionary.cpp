@@ -0,0 +1,109 @@
+#include "term_dictionary.h"
+#include <algorithm>
+#include <deque>
+#include <numeric>
+
+using namespace std;
+
+TermDictionary::TermDictionary(const InvertedIndex& index, size_t document_count)
+    : term_count_(index.GetTermCount())
+    , document_count_(document_count)
+{
+    std::vector<InvertedIndex::TermId> term_ids(term_count_);
+    std::iota(term_ids.begin(), term_ids.end(), 0);
+    std::sort(term_ids.begin(), term_ids.end(), [&index](InvertedIndex::TermId lhs, InvertedIndex::TermId rhs) {
+        return index.GetTerm(lhs) < index.GetTerm(rhs);
+    });
+
+    // Узел дерева — отрезок отсортированных слов с общим префиксом длины depth.
+    // Отрезки разбираются в порядке очереди, поэтому дети каждого узла добавляются подряд.
+    struct Range {
+        uint32_t node;
+        size_t first;
+        size_t last;
+        size_t depth;
+    };
+    nodes_.push_back({ 0, 0, InvertedIndex::NO_TERM, 0 });
+    labels_.push_back('\0');
+    std::deque<Range> ranges;
+    ranges.push_back({ 0, 0, term_ids.size(), 0 });
+    while (!ranges.empty()) {
+        auto [node, first, last, depth] = ranges.front();
+        ranges.pop_front();
+        for (size_t i = first; i < last; ++i) {
+            nodes_[node].max_document_freq = std::max(nodes_[node].max_document_freq, static_cast<uint32_t>(index.GetPostings(term_ids[i]).size()));
+        }
+        // Слово, которое кончается в узле, в отрезке первое: оно префикс остальных
+        if (first < last && index.GetTerm(term_ids[first]).size() == depth) {
+            nodes_[node].term_id = term_ids[first];
+            ++first;
+        }
+        nodes_[node].first_child = static_cast<uint32_t>(nodes_.size());
+        while (first < last) {
+            const char label = index.GetTerm(term_ids[first])[depth];
+            size_t group_end = first + 1;
+            while (group_end < last && index.GetTerm(term_ids[group_end])[depth] == label) {
+                ++group_end;
+            }
+            ranges.push_back({ static_cast<uint32_t>(nodes_.size()), first, group_end, depth + 1 });
+            nodes_.push_back({ 0, 0, InvertedIndex::NO_TERM, 0 });
+            labels_.push_back(label);
+            ++nodes_[node].child_count;
+            first = group_end;
+        }
+    }
+    nodes_.shrink_to_fit();
+    labels_.shrink_to_fit();
+}
+
+size_t TermDictionary::GetTermCount() const {
+    return term_count_;
+}
+
+size_t TermDictionary::GetDocumentCount() const {
+    return document_count_;
+}
+
+TermDictionary::GlobMatcher::GlobMatcher(std::string_view pattern)
+    : pattern_size_(pattern.size())
+{
+    for (size_t position = 0; position < pattern.size(); ++position) {
+        const State bit = State(1) << position;
+        if (pattern[position] == '*') {
+            star_mask_ |= bit;
+        }
+        else if (pattern[position] == '?') {
+            for (State& mask : byte_masks_) {
+                mask |= bit;
+            }
+        }
+        else {
+            byte_masks_[static_cast<unsigned char>(pattern[position])] |= bit;
+        }
+    }
+}
+
+TermDictionary::LevenshteinMatcher::State TermDictionary::LevenshteinMatcher::Start() const {
+    State state{};
+    for (size_t j = 0; j <= word.size(); ++j) {
+        state[j] = static_cast<uint8_t>(j);
+    }
+    return state;
+}
+
+TermDictionary::LevenshteinMatcher::State TermDictionary::LevenshteinMatcher::Step(const State& state, char byte) const {
+    // Расстояния больше max_distance + 1 не различаются, поэтому значения не переполняют байт
+    const int limit = max_distance + 1;
+    State next{};
+    next[0] = static_cast<uint8_t>(std::min(state[0] + 1, limit));
+    for (size_t j = 1; j <= word.size(); ++j) {
+        const int substitution = state[j - 1] + (word[j - 1] == byte ? 0 : 1);
+        const int distance = std::min({ state[j] + 1, next[j - 1] + 1, substitution });
+        next[j] = static_cast<uint8_t>(std::min(distance, limit));
+    }
+    return next;
+}
+
+bool TermDictionary::LevenshteinMatcher::CanMatch(const State& state) const {
+    return *std::min_element(state.begin(), state.begin() + word.size() + 1) <= max_distance;
+}
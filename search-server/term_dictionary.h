@@ -0,0 +1,183 @@
+#pragma once
+#include "inverted_index.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <string_view>
+#include <vector>
+
+// Неизменяемый словарь слов индекса — префиксное дерево в плоских массивах.
+// Узлы лежат в порядке обхода в ширину, дети узла идут подряд, поэтому узел — 16 байт и байт метки ребра,
+// без указателей и отдельных выделений памяти.
+// Слова ищутся обходом дерева вместе с автоматом: шаблона (* и ?) или Левенштейна (опечатки).
+// Ветка, в которой автомат уже не может дойти до совпадения, отсекается целиком,
+// поэтому просматривается малая часть словаря.
+// Узел помнит наибольшее число документов у слов своего поддерева. Ветки обходятся по убыванию этой оценки,
+// и когда вызывающему нужны только слова с большим числом документов, остаток дерева не обходится.
+// Слова, добавленные в индекс после построения словаря, проверяются тем же автоматом по одному.
+class TermDictionary {
+public:
+    // Самый длинный шаблон или слово для поиска с опечатками: состояние автомата занимает машинное слово
+    static const size_t MAX_PATTERN_LENGTH = 63;
+
+    // document_count — сколько документов добавлено в индекс к моменту построения, считая удалённые
+    TermDictionary(const InvertedIndex& index, size_t document_count);
+
+    // Сколько первых идентификаторов слов индекса входит в дерево
+    size_t GetTermCount() const;
+
+    size_t GetDocumentCount() const;
+
+    // Поиск передаёт слова в callback(term_id), а тот возвращает, сколько документов должно быть у слова,
+    // чтобы оно ещё было нужно. Оценки узлов сделаны при построении, поэтому к ним прибавляется число документов,
+    // добавленных после него (document_count — сколько их добавлено всего): слово не могло попасть в большее число.
+    // Слова без документов не передаются.
+
+    // Слова, подходящие под шаблон: * — любая последовательность байт, в том числе пустая, ? — любой один байт
+    template <typename Callback>
+    void ForEachMatching(std::string_view pattern, const InvertedIndex& index, size_t document_count, Callback callback) const;
+
+    // Слова на расстоянии Левенштейна не больше max_distance от word
+    template <typename Callback>
+    void ForEachSimilar(std::string_view word, int max_distance, const InvertedIndex& index, size_t document_count, Callback callback) const;
+
+private:
+    struct Node {
+        uint32_t first_child;
+        uint32_t child_count;
+        InvertedIndex::TermId term_id;
+        // Наибольшее число документов у слов поддерева при построении
+        uint32_t max_document_freq;
+    };
+
+    size_t term_count_;
+    size_t document_count_;
+    std::vector<Node> nodes_;
+    // Байт на ребре, ведущем в узел
+    std::vector<char> labels_;
+
+    // Недетерминированный автомат шаблона: бит i — прочитанное совпало с первыми i символами шаблона.
+    // Переход по байту — несколько битовых операций (Shift-And), звёздочка оставляет свой бит на месте.
+    class GlobMatcher {
+    public:
+        using State = uint64_t;
+
+        explicit GlobMatcher(std::string_view pattern);
+
+        State Start() const {
+            return Close(1);
+        }
+
+        State Step(State state, char byte) const {
+            return Close(((state & byte_masks_[static_cast<unsigned char>(byte)]) << 1) | (state & star_mask_));
+        }
+
+        bool IsMatch(State state) const {
+            return (state >> pattern_size_) & 1;
+        }
+
+        bool CanMatch(State state) const {
+            return state != 0;
+        }
+
+    private:
+        size_t pattern_size_;
+        // Позиции шаблона, где стоит этот байт или ?
+        std::array<State, 256> byte_masks_{};
+        State star_mask_ = 0;
+
+        // Звёздочка пропускается без чтения байта
+        State Close(State state) const {
+            for (State next = state | ((state & star_mask_) << 1); next != state; next = state | ((state & star_mask_) << 1)) {
+                state = next;
+            }
+            return state;
+        }
+    };
+
+    // Автомат Левенштейна в виде строки таблицы расстояний: элемент j — расстояние от прочитанного до первых j байт слова
+    struct LevenshteinMatcher {
+        using State = std::array<uint8_t, MAX_PATTERN_LENGTH + 1>;
+
+        std::string_view word;
+        int max_distance;
+
+        State Start() const;
+
+        State Step(const State& state, char byte) const;
+
+        bool IsMatch(const State& state) const {
+            return state[word.size()] <= max_distance;
+        }
+
+        bool CanMatch(const State& state) const;
+    };
+
+    template <typename Matcher, typename Callback>
+    void Traverse(const Matcher& matcher, const InvertedIndex& index, size_t document_count, Callback& callback) const;
+};
+
+template <typename Callback>
+void TermDictionary::ForEachMatching(std::string_view pattern, const InvertedIndex& index, size_t document_count, Callback callback) const {
+    Traverse(GlobMatcher(pattern), index, document_count, callback);
+}
+
+template <typename Callback>
+void TermDictionary::ForEachSimilar(std::string_view word, int max_distance, const InvertedIndex& index, size_t document_count, Callback callback) const {
+    Traverse(LevenshteinMatcher{ word, max_distance }, index, document_count, callback);
+}
+
+template <typename Matcher, typename Callback>
+void TermDictionary::Traverse(const Matcher& matcher, const InvertedIndex& index, size_t document_count, Callback& callback) const {
+    size_t min_document_freq = 1;
+    // Новые слова проверяются первыми: их мало, а найденные поднимают порог для обхода дерева
+    for (size_t term_id = term_count_; term_id < index.GetTermCount(); ++term_id) {
+        const auto id = static_cast<InvertedIndex::TermId>(term_id);
+        if (index.GetPostings(id).size() < min_document_freq) {
+            continue;
+        }
+        typename Matcher::State state = matcher.Start();
+        for (const char byte : index.GetTerm(id)) {
+            state = matcher.Step(state, byte);
+            if (!matcher.CanMatch(state)) {
+                break;
+            }
+        }
+        if (matcher.CanMatch(state) && matcher.IsMatch(state)) {
+            min_document_freq = std::max<size_t>(min_document_freq, callback(id));
+        }
+    }
+
+    struct Frame {
+        size_t bound;
+        uint32_t node;
+        typename Matcher::State state;
+
+        bool operator<(const Frame& other) const {
+            return bound < other.bound;
+        }
+    };
+    const size_t added_document_count = document_count - document_count_;
+    std::priority_queue<Frame> frames;
+    frames.push({ nodes_[0].max_document_freq + added_document_count, 0, matcher.Start() });
+    while (!frames.empty() && frames.top().bound >= min_document_freq) {
+        const Frame frame = frames.top();
+        frames.pop();
+        const Node& node = nodes_[frame.node];
+        if (node.term_id != InvertedIndex::NO_TERM && matcher.IsMatch(frame.state)
+            && index.GetPostings(node.term_id).size() >= min_document_freq) {
+            min_document_freq = std::max<size_t>(min_document_freq, callback(node.term_id));
+        }
+        for (uint32_t child = node.first_child; child < node.first_child + node.child_count; ++child) {
+            const size_t bound = nodes_[child].max_document_freq + added_document_count;
+            if (bound < min_document_freq) {
+                continue;
+            }
+            const typename Matcher::State state = matcher.Step(frame.state, labels_[child]);
+            if (matcher.CanMatch(state)) {
+                frames.push({ bound, child, state });
+            }
+        }
+    }
+}
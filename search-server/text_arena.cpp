@@ -0,0 +1,50 @@
+#include "text_arena.h"
+#include <algorithm>
+
+TextArena::TextArena(size_t block_size)
+    : block_size_(block_size)
+{
+}
+
+std::string_view TextArena::Store(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    char* destination;
+    if (text.size() > block_free_) {
+        // Длинный текст получает собственный блок, а текущий блок продолжает заполняться
+        const size_t new_block_size = std::max(block_size_, text.size());
+        blocks_.push_back(std::make_unique<char[]>(new_block_size));
+        reserved_bytes_ += new_block_size;
+        destination = blocks_.back().get();
+        if (new_block_size - text.size() >= block_free_) {
+            block_pos_ = destination + text.size();
+            block_free_ = new_block_size - text.size();
+        }
+    }
+    else {
+        destination = block_pos_;
+        block_pos_ += text.size();
+        block_free_ -= text.size();
+    }
+    std::copy(text.begin(), text.end(), destination);
+    used_bytes_ += text.size();
+    return { destination, text.size() };
+}
+
+void TextArena::Release(std::string_view text) {
+    used_bytes_ -= text.size();
+    released_bytes_ += text.size();
+}
+
+size_t TextArena::GetUsedBytes() const {
+    return used_bytes_;
+}
+
+size_t TextArena::GetReleasedBytes() const {
+    return released_bytes_;
+}
+
+size_t TextArena::GetReservedBytes() const {
+    return reserved_bytes_;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Строки складываются подряд в крупные блоки: отдельное выделение памяти на строку не нужно,
+// а сохранённые строки не перемещаются, пока арена жива.
+// Освобождённое место только учитывается, вернуть его можно, переложив живые строки в новую арену.
+class TextArena {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit TextArena(size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    std::string_view Store(std::string_view text);
+
+    // Строка должна была быть получена из Store этой арены
+    void Release(std::string_view text);
+
+    // Байты живых строк
+    size_t GetUsedBytes() const;
+
+    // Байты строк, отданных через Release
+    size_t GetReleasedBytes() const;
+
+    // Память, занятая блоками
+    size_t GetReservedBytes() const;
+
+private:
+    size_t block_size_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* block_pos_ = nullptr;
+    size_t block_free_ = 0;
+    size_t used_bytes_ = 0;
+    size_t released_bytes_ = 0;
+    size_t reserved_bytes_ = 0;
+};
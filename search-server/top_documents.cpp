@@ -0,0 +1,62 @@
+#include "top_documents.h"
+#include "search_server.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < COMPARISON_ACCURACY) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+TopDocuments::TopDocuments(size_t top_count, const Document* after)
+    : top_count_(top_count)
+{
+    if (after) {
+        after_ = *after;
+    }
+    heap_.reserve(top_count_);
+}
+
+void TopDocuments::Add(const Document& document) {
+    if (after_ && !IsMoreRelevant(*after_, document)) {
+        return;
+    }
+    if (heap_.size() < top_count_) {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+    else if (!heap_.empty() && IsMoreRelevant(document, heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        heap_.back() = document;
+        std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    }
+}
+
+void TopDocuments::Merge(const TopDocuments& other) {
+    for (const Document& document : other.heap_) {
+        Add(document);
+    }
+}
+
+double TopDocuments::GetEntryThreshold() const {
+    if (top_count_ == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    if (heap_.size() < top_count_) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return heap_.front().relevance;
+}
+
+std::vector<Document> TopDocuments::Extract() {
+    std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    std::vector<Document> result;
+    result.swap(heap_);
+    return result;
+}
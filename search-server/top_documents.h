@@ -0,0 +1,32 @@
+#pragma once
+#include "document.h"
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// Порядок выдачи: по убыванию релевантности, при равной релевантности по убыванию рейтинга,
+// затем по возрастанию id, чтобы порядок был однозначным и страницы выдачи не пересекались
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Хранит не больше top_count лучших документов из переданного потока.
+// Худший из отобранных лежит в вершине кучи и вытесняется первым.
+// Если задан after, берутся только документы, идущие в выдаче после него.
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t top_count, const Document* after = nullptr);
+
+    void Add(const Document& document);
+
+    void Merge(const TopDocuments& other);
+
+    // Релевантность худшего отобранного документа, пока набраны не все — минус бесконечность
+    double GetEntryThreshold() const;
+
+    // Отобранные документы в порядке выдачи
+    std::vector<Document> Extract();
+
+private:
+    size_t top_count_;
+    std::optional<Document> after_;
+    std::vector<Document> heap_;
+};
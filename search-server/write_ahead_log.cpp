@@ -0,0 +1,385 @@
+#include "write_ahead_log.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[8] = { 'S', 'R', 'C', 'H', 'W', 'A', 'L', '\0' };
+const uint32_t VERSION = 1;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Числа записаны в порядке байт машины, как и в снимке индекса
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    // Номер, с которого начинаются записи файла
+    uint64_t first_sequence;
+};
+
+// Контрольная сумма считается по размеру, номеру и содержимому записи
+struct RecordHeader {
+    uint32_t size;
+    uint32_t checksum;
+    uint64_t sequence;
+};
+
+static_assert(std::is_trivially_copyable_v<FileHeader> && std::is_trivially_copyable_v<RecordHeader>);
+
+// Буфер, который не успевает уйти на диск, ограничен несколькими пачками
+const size_t MAX_BUFFERED_SYNCS = 4;
+
+class Crc32cTable {
+public:
+    Crc32cTable() {
+        for (uint32_t byte = 0; byte < 256; ++byte) {
+            uint32_t crc = byte;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+            }
+            table_[byte] = crc;
+        }
+    }
+
+    uint32_t Update(uint32_t crc, const char* data, size_t size) const {
+        for (size_t i = 0; i < size; ++i) {
+            crc = table_[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+private:
+    uint32_t table_[256];
+};
+
+// CRC32C (Castagnoli): с SSE 4.2 считается инструкцией crc32 по 8 байт, иначе по таблице
+uint32_t UpdateCrc32c(uint32_t crc, const char* data, size_t size) {
+#ifdef __SSE4_2__
+    uint64_t crc64 = crc;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+    }
+    crc = static_cast<uint32_t>(crc64);
+    for (; size > 0; ++data, --size) {
+        crc = _mm_crc32_u8(crc, static_cast<uint8_t>(*data));
+    }
+    return crc;
+#else
+    static const Crc32cTable table;
+    return table.Update(crc, data, size);
+#endif
+}
+
+template <typename Parts>
+uint32_t ComputeChecksum(uint32_t size, uint64_t sequence, const Parts& parts) {
+    uint32_t crc = ~0u;
+    crc = UpdateCrc32c(crc, reinterpret_cast<const char*>(&size), sizeof(size));
+    crc = UpdateCrc32c(crc, reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+    for (const std::string_view part : parts) {
+        crc = UpdateCrc32c(crc, part.data(), part.size());
+    }
+    return ~crc;
+}
+
+uint32_t ComputeChecksum(uint32_t size, uint64_t sequence, std::string_view payload) {
+    return ComputeChecksum(size, sequence, std::array{ payload });
+}
+
+std::string GetErrorText(const std::string& action, const std::string& path) {
+    return action + " "s + path + ": "s + std::strerror(errno);
+}
+
+void WriteAll(int fd, const char* data, size_t size, const std::string& path) {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(GetErrorText("Ошибка записи в журнал"s, path));
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// Переименование и создание файла становятся устойчивыми только после синхронизации каталога
+void SyncParentDirectory(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    const std::string directory = slash == std::string::npos ? "."s : slash == 0 ? "/"s : path.substr(0, slash);
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        throw std::runtime_error(GetErrorText("Не удалось открыть каталог журнала"s, directory));
+    }
+    const int result = fsync(fd);
+    close(fd);
+    if (result != 0) {
+        throw std::runtime_error(GetErrorText("Не удалось синхронизировать каталог журнала"s, directory));
+    }
+}
+
+// Пустой журнал пишется во временный файл и подменяет старый переименованием:
+// при падении на любом шаге на месте остаётся либо старый журнал, либо новый целиком
+int CreateLogFile(const std::string& path, uint64_t first_sequence) {
+    const std::string temp_path = path + ".tmp"s;
+    const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(GetErrorText("Не удалось создать журнал"s, temp_path));
+    }
+    try {
+        FileHeader header{};
+        std::copy(std::begin(MAGIC), std::end(MAGIC), header.magic);
+        header.version = VERSION;
+        header.byte_order_mark = BYTE_ORDER_MARK;
+        header.first_sequence = first_sequence;
+        WriteAll(fd, reinterpret_cast<const char*>(&header), sizeof(header), temp_path);
+        if (fdatasync(fd) != 0) {
+            throw std::runtime_error(GetErrorText("Не удалось синхронизировать журнал"s, temp_path));
+        }
+        if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error(GetErrorText("Не удалось заменить журнал"s, path));
+        }
+        SyncParentDirectory(path);
+    }
+    catch (...) {
+        close(fd);
+        throw;
+    }
+    return fd;
+}
+
+std::string ReadFile(int fd, const std::string& path) {
+    std::string data;
+    char chunk[64 * 1024];
+    while (true) {
+        const ssize_t received = read(fd, chunk, sizeof(chunk));
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(GetErrorText("Ошибка чтения журнала"s, path));
+        }
+        if (received == 0) {
+            return data;
+        }
+        data.append(chunk, received);
+    }
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& path, uint64_t first_sequence, const Replay& replay, WriteAheadLogOptions options)
+    : path_(path)
+    , options_(options)
+{
+    uint64_t next_sequence = std::max<uint64_t>(first_sequence, 1);
+    const int fd = open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    if (fd < 0 && errno != ENOENT) {
+        throw std::runtime_error(GetErrorText("Не удалось открыть журнал"s, path));
+    }
+    if (fd >= 0) {
+        std::string data;
+        try {
+            data = ReadFile(fd, path);
+        }
+        catch (...) {
+            close(fd);
+            throw;
+        }
+        FileHeader header;
+        // Файл короче заголовка остаётся от падения при создании журнала, записей в нём нет
+        if (data.size() >= sizeof(header)) {
+            std::memcpy(&header, data.data(), sizeof(header));
+            if (!std::equal(std::begin(MAGIC), std::end(MAGIC), header.magic) || header.version != VERSION
+                || header.byte_order_mark != BYTE_ORDER_MARK) {
+                close(fd);
+                throw std::invalid_argument("Файл "s + path + " не является журналом или записан другой версией"s);
+            }
+            // Записи идут подряд по номерам, начиная с first_sequence; разрыв означает повреждённый хвост
+            uint64_t expected_sequence = header.first_sequence;
+            size_t position = sizeof(header);
+            while (data.size() - position >= sizeof(RecordHeader)) {
+                RecordHeader record;
+                std::memcpy(&record, data.data() + position, sizeof(record));
+                if (data.size() - position - sizeof(record) < record.size) {
+                    break;
+                }
+                const std::string_view payload(data.data() + position + sizeof(record), record.size);
+                if (record.checksum != ComputeChecksum(record.size, record.sequence, payload) || record.sequence != expected_sequence) {
+                    break;
+                }
+                try {
+                    replay(record.sequence, payload);
+                }
+                catch (...) {
+                    close(fd);
+                    throw;
+                }
+                ++expected_sequence;
+                position += sizeof(record) + record.size;
+            }
+            next_sequence = std::max(next_sequence, expected_sequence);
+            if (position < data.size() && ftruncate(fd, position) != 0) {
+                close(fd);
+                throw std::runtime_error(GetErrorText("Не удалось обрезать повреждённый хвост журнала"s, path));
+            }
+            fd_ = fd;
+            size_ = position;
+        }
+        else {
+            close(fd);
+        }
+    }
+    if (fd_ < 0) {
+        fd_ = CreateLogFile(path, next_sequence);
+        size_ = sizeof(FileHeader);
+    }
+    last_sequence_ = next_sequence - 1;
+    durable_sequence_ = last_sequence_;
+    flusher_ = std::thread([this] { FlushLoop(); });
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard guard(mutex_);
+        stop_ = true;
+    }
+    flush_requested_.notify_one();
+    flusher_.join();
+    close(fd_);
+}
+
+template <typename Parts>
+uint64_t WriteAheadLog::AppendParts(const Parts& parts) {
+    size_t payload_size = 0;
+    for (const std::string_view part : parts) {
+        payload_size += part.size();
+    }
+    if (payload_size > UINT32_MAX) {
+        throw std::invalid_argument("Запись журнала слишком велика"s);
+    }
+    std::unique_lock lock(mutex_);
+    flushed_.wait(lock, [this] { return !error_.empty() || buffer_.size() < options_.sync_bytes * MAX_BUFFERED_SYNCS; });
+    ThrowIfFailed();
+    RecordHeader record{ static_cast<uint32_t>(payload_size), 0, last_sequence_ + 1 };
+    record.checksum = ComputeChecksum(record.size, record.sequence, parts);
+    buffer_.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    for (const std::string_view part : parts) {
+        buffer_.append(part);
+    }
+    size_ += sizeof(record) + payload_size;
+    last_sequence_ = record.sequence;
+    if (buffer_.size() >= options_.sync_bytes) {
+        flush_requested_.notify_one();
+    }
+    return record.sequence;
+}
+
+uint64_t WriteAheadLog::Append(std::string_view payload) {
+    return AppendParts(std::array{ payload });
+}
+
+uint64_t WriteAheadLog::Append(const std::vector<std::string_view>& parts) {
+    return AppendParts(parts);
+}
+
+void WriteAheadLog::WaitDurable(uint64_t sequence) {
+    std::unique_lock lock(mutex_);
+    if (durable_sequence_ < sequence) {
+        sync_requested_ = true;
+        flush_requested_.notify_one();
+        flushed_.wait(lock, [this, sequence] { return !error_.empty() || durable_sequence_ >= sequence; });
+    }
+    ThrowIfFailed();
+}
+
+void WriteAheadLog::Sync() {
+    WaitDurable(GetLastSequence());
+}
+
+void WriteAheadLog::Reset() {
+    std::unique_lock lock(mutex_);
+    sync_requested_ = true;
+    flush_requested_.notify_one();
+    flushed_.wait(lock, [this] { return !error_.empty() || (buffer_.empty() && !is_writing_); });
+    ThrowIfFailed();
+    const int fd = CreateLogFile(path_, last_sequence_ + 1);
+    close(fd_);
+    fd_ = fd;
+    size_ = sizeof(FileHeader);
+}
+
+uint64_t WriteAheadLog::GetLastSequence() const {
+    std::lock_guard guard(mutex_);
+    return last_sequence_;
+}
+
+uint64_t WriteAheadLog::GetSize() const {
+    std::lock_guard guard(mutex_);
+    return size_;
+}
+
+void WriteAheadLog::FlushLoop() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        flush_requested_.wait_for(lock, options_.sync_interval, [this] {
+            return stop_ || sync_requested_ || buffer_.size() >= options_.sync_bytes;
+        });
+        if (buffer_.empty() || !error_.empty()) {
+            sync_requested_ = false;
+            if (stop_) {
+                return;
+            }
+            continue;
+        }
+        // Пока пачка пишется на диск, Append продолжает копить записи в опустевший буфер
+        std::swap(buffer_, writing_);
+        const uint64_t sequence = last_sequence_;
+        const int fd = fd_;
+        sync_requested_ = false;
+        is_writing_ = true;
+        lock.unlock();
+        std::string error;
+        try {
+            WriteAll(fd, writing_.data(), writing_.size(), path_);
+            if (fdatasync(fd) != 0) {
+                throw std::runtime_error(GetErrorText("Не удалось синхронизировать журнал"s, path_));
+            }
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+        }
+        writing_.clear();
+        lock.lock();
+        is_writing_ = false;
+        if (error.empty()) {
+            durable_sequence_ = sequence;
+        }
+        else {
+            error_ = std::move(error);
+        }
+        flushed_.notify_all();
+    }
+}
+
+void WriteAheadLog::ThrowIfFailed() const {
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+}
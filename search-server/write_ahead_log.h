@@ -0,0 +1,90 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct WriteAheadLogOptions {
+    // Накопленные записи сбрасываются на диск не реже, чем раз в sync_interval,
+    // и сразу, как только их набралось sync_bytes
+    std::chrono::milliseconds sync_interval{ 10 };
+    size_t sync_bytes = 4 * 1024 * 1024;
+};
+
+// Журнал, который только дописывается. Запись хранит свой номер и контрольную сумму CRC32C,
+// поэтому оборванная при падении запись в конце файла распознаётся и отбрасывается при открытии.
+// Append только копирует запись в память. Фоновый поток сбрасывает всё накопленное
+// одним write и одним fdatasync (групповая фиксация): сколько бы записей ни ждало,
+// на диск они уходят за одну синхронизацию.
+class WriteAheadLog {
+public:
+    using Replay = std::function<void(uint64_t sequence, std::string_view payload)>;
+
+    // Открывает журнал или создаёт пустой и передаёт replay все целые записи по порядку.
+    // Хвост файла после первой повреждённой записи обрезается.
+    // Номера новых записей начинаются не меньше first_sequence.
+    WriteAheadLog(const std::string& path, uint64_t first_sequence, const Replay& replay, WriteAheadLogOptions options = {});
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Сбрасывает на диск оставшиеся записи
+    ~WriteAheadLog();
+
+    // Возвращает номер записи. Если диск не успевает за записями, ждёт, пока буфер не освободится.
+    uint64_t Append(std::string_view payload);
+
+    // Запись из нескольких частей подряд: большие части (тексты документов) копируются сразу в буфер журнала
+    uint64_t Append(const std::vector<std::string_view>& parts);
+
+    // Ждёт, пока на диске не окажутся все записи с номерами до sequence включительно
+    void WaitDurable(uint64_t sequence);
+
+    // Ждёт, пока на диске не окажутся все уже добавленные записи
+    void Sync();
+
+    // Сбрасывает накопленные записи на диск и заменяет журнал пустым; записи больше не нужны, номера продолжаются.
+    // Файл заменяется под блокировкой, когда фоновый поток ничего не пишет, поэтому он не пишет в закрытый файл.
+    void Reset();
+
+    // Номер последней добавленной записи, 0 — если записей ещё не было
+    uint64_t GetLastSequence() const;
+
+    // Размер журнала вместе с ещё не сброшенными записями
+    uint64_t GetSize() const;
+
+private:
+    std::string path_;
+    WriteAheadLogOptions options_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable flush_requested_;
+    std::condition_variable flushed_;
+    std::string buffer_;
+    uint64_t last_sequence_ = 0;
+    uint64_t durable_sequence_ = 0;
+    uint64_t size_ = 0;
+    bool sync_requested_ = false;
+    bool stop_ = false;
+    // Текст ошибки записи на диск. После ошибки журнал не принимает записей.
+    std::string error_;
+    // Буфер, который пишет фоновый поток; после записи очищается и переиспользуется
+    std::string writing_;
+    // Фоновый поток пишет writing_ в fd_ без блокировки
+    bool is_writing_ = false;
+    std::thread flusher_;
+
+    template <typename Parts>
+    uint64_t AppendParts(const Parts& parts);
+
+    void FlushLoop();
+
+    void ThrowIfFailed() const;
+};